@@ -0,0 +1,209 @@
+#include "backtest.h"
+#include "matching_engine.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// Strategy order ids live far above any recorded id.
+constexpr uint64_t kStrategyIdBase = 1ull << 62;
+constexpr uint32_t kStrategyAccount = RiskChecker::kMaxAccounts - 1;
+
+class QuotingStrategy {
+public:
+    QuotingStrategy(const StrategyParams& params, BacktestResult& result)
+        : params(params), result(result) {}
+
+    void on_trade(const Trade& trade) {
+        last_price = trade.price;
+        bool bidFill = bid_remaining > 0 && (trade.maker_order_id == bid_id || trade.taker_order_id == bid_id);
+        bool askFill = ask_remaining > 0 && (trade.maker_order_id == ask_id || trade.taker_order_id == ask_id);
+        if (bidFill) {
+            result.inventory += trade.quantity;
+            result.cash -= trade.price * trade.quantity;
+            result.bought += trade.quantity;
+            bid_remaining -= trade.quantity;
+            ++result.fills;
+        }
+        if (askFill) {
+            result.inventory -= trade.quantity;
+            result.cash += trade.price * trade.quantity;
+            result.sold += trade.quantity;
+            ask_remaining -= trade.quantity;
+            ++result.fills;
+        }
+    }
+
+    void requote(MatchingEngine& engine, uint64_t timestamp) {
+        if (last_price <= 0)
+            return;
+        quote(engine, timestamp, true, last_price - params.half_spread,
+              result.inventory + params.quote_size <= params.max_inventory);
+        quote(engine, timestamp, false, last_price + params.half_spread,
+              result.inventory - params.quote_size >= -params.max_inventory);
+    }
+
+    double mark() const { return last_price; }
+
+private:
+    void quote(MatchingEngine& engine, uint64_t timestamp, bool is_bid, double price, bool wanted) {
+        uint64_t& id = is_bid ? bid_id : ask_id;
+        double& remaining = is_bid ? bid_remaining : ask_remaining;
+
+        Order order{};
+        order.timestamp = timestamp;
+        order.account = kStrategyAccount;
+        if (remaining > 0) {
+            // Still resting: amend in place (or pull it if the side is capped).
+            order.id = id;
+            order.action = wanted ? OrderAction::MODIFY : OrderAction::CANCEL;
+            order.price = price;
+            order.quantity = params.quote_size;
+        } else {
+            if (!wanted || price <= 0)
+                return;
+            order.id = id = kStrategyIdBase + next_id++;
+            order.action = OrderAction::NEW;
+            order.type = OrderType::LIMIT;
+            order.is_bid = is_bid;
+            order.price = price;
+            order.quantity = params.quote_size;
+        }
+
+        if (engine.process_inline(order) != RiskReject::NONE) {
+            ++result.risk_rejects;
+            return;
+        }
+        if (order.action != OrderAction::CANCEL)
+            ++result.quotes;
+        remaining = order.action == OrderAction::CANCEL ? 0.0 : order.quantity;
+    }
+
+    const StrategyParams& params;
+    BacktestResult& result;
+    uint64_t next_id = 0;
+    uint64_t bid_id = 0;
+    uint64_t ask_id = 0;
+    double bid_remaining = 0.0;
+    double ask_remaining = 0.0;
+    double last_price = 0.0;
+};
+
+// Fixed task set, one deque per worker. Owners pop from the back of their own
+// deque; idle workers steal from the front of the others', so a few slow
+// runs do not leave the rest of the pool waiting.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned threads) : workers(threads) {}
+
+    void run(size_t task_count, const std::function<void(size_t)>& task) {
+        // Contiguous blocks per worker: neighbouring tasks share a scenario
+        // and therefore have similar cost.
+        size_t n = workers.size();
+        for (size_t w = 0; w < n; ++w) {
+            for (size_t t = task_count * w / n; t < task_count * (w + 1) / n; ++t)
+                workers[w].tasks.push_back(t);
+        }
+
+        std::vector<std::thread> threads;
+        for (size_t w = 0; w < n; ++w) {
+            threads.emplace_back([this, w, &task] {
+                size_t t;
+                while (pop_local(w, t) || steal(w, t))
+                    task(t);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+private:
+    struct alignas(64) Worker {
+        std::mutex mtx;
+        std::deque<size_t> tasks;
+    };
+
+    bool pop_local(size_t w, size_t& task) {
+        std::lock_guard<std::mutex> lock(workers[w].mtx);
+        if (workers[w].tasks.empty())
+            return false;
+        task = workers[w].tasks.back();
+        workers[w].tasks.pop_back();
+        return true;
+    }
+
+    bool steal(size_t w, size_t& task) {
+        for (size_t i = 1; i < workers.size(); ++i) {
+            Worker& victim = workers[(w + i) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mtx);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<Worker> workers;
+};
+
+} // namespace
+
+BacktestResult run_backtest(const EventFile& events, const Scenario& scenario,
+                            const StrategyParams& params, const RiskLimits& limits) {
+    auto wallStart = std::chrono::steady_clock::now();
+    BacktestResult result;
+
+    MatchingEngine engine;  // Never started: everything runs inline
+    engine.set_risk_limits(limits);
+    OrderBook& book = engine.get_order_book();
+    QuotingStrategy strategy(params, result);
+
+    size_t last = scenario.last_event == 0 ? events.size() : std::min(scenario.last_event, events.size());
+    uint32_t sinceQuote = 0;
+    for (size_t i = scenario.first_event; i < last; ++i) {
+        const RecordedEvent& event = events.events()[i];
+        engine.process_inline(event.to_order());
+        for (const Trade& trade : book.get_trades())
+            strategy.on_trade(trade);
+
+        if (++sinceQuote >= params.requote_interval) {
+            sinceQuote = 0;
+            strategy.requote(engine, event.timestamp);
+            for (const Trade& trade : book.get_trades())
+                strategy.on_trade(trade);
+        }
+        ++result.events;
+    }
+
+    result.pnl = result.cash + result.inventory * strategy.mark();
+    result.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+    return result;
+}
+
+BacktestRunner::BacktestRunner(unsigned threads)
+    : threads(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency()))
+{
+}
+
+std::vector<BacktestResult> BacktestRunner::run(const EventFile& events,
+                                                const std::vector<Scenario>& scenarios,
+                                                const std::vector<StrategyParams>& params,
+                                                const RiskLimits& limits) const {
+    std::vector<BacktestResult> results(scenarios.size() * params.size());
+    WorkStealingPool pool(threads);
+    pool.run(results.size(), [&](size_t task) {
+        size_t s = task / params.size();
+        size_t p = task % params.size();
+        BacktestResult result = run_backtest(events, scenarios[s], params[p], limits);
+        result.scenario_index = s;
+        result.params_index = p;
+        results[task] = result;
+    });
+    return results;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "event_file.h"
+#include "risk_check.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Parameters of the reference quoting strategy: a symmetric two-sided quote
+// around the last trade price, refreshed every requote_interval events and
+// pulled on the side that would push inventory past max_inventory.
+struct StrategyParams {
+    double half_spread = 0.05;
+    double quote_size = 5.0;
+    uint32_t requote_interval = 50;
+    double max_inventory = 100.0;
+};
+
+// A slice of the recorded event file, [first_event, last_event).
+// last_event == 0 means "to the end of the file".
+struct Scenario {
+    std::string name;
+    size_t first_event = 0;
+    size_t last_event = 0;
+};
+
+struct BacktestResult {
+    size_t scenario_index = 0;
+    size_t params_index = 0;
+    uint64_t events = 0;
+    uint64_t quotes = 0;         // NEW + MODIFY messages sent by the strategy
+    uint64_t risk_rejects = 0;
+    uint64_t fills = 0;
+    double bought = 0.0;
+    double sold = 0.0;
+    double inventory = 0.0;
+    double cash = 0.0;
+    double pnl = 0.0;            // cash + inventory marked at the last trade
+    double wall_ms = 0.0;        // Timing only; not part of the deterministic result
+};
+
+// One independent engine + strategy replay, entirely on the calling thread.
+BacktestResult run_backtest(const EventFile& events, const Scenario& scenario,
+                            const StrategyParams& params, const RiskLimits& limits);
+
+// Runs every (scenario, params) pair on a work-stealing thread pool. Each run
+// is single-threaded and clock-free, and results are stored by pair index, so
+// the output is identical for any thread count.
+class BacktestRunner {
+public:
+    explicit BacktestRunner(unsigned threads = 0);  // 0 = hardware concurrency
+
+    std::vector<BacktestResult> run(const EventFile& events,
+                                    const std::vector<Scenario>& scenarios,
+                                    const std::vector<StrategyParams>& params,
+                                    const RiskLimits& limits = RiskLimits()) const;
+
+    unsigned thread_count() const { return threads; }
+
+private:
+    unsigned threads;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <map>
+#include <type_traits>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+// Price representations. Every policy rounds incoming prices to the 0.01 tick
+// the book has always used; they differ only in how the key is stored.
+
+// Prices kept as doubles rounded to the tick (the original book layout).
+struct DecimalPrice {
+    using type = double;
+
+    static type from_double(double price) { return std::round(price * 100.0) / 100.0; }
+    static double to_double(type price) { return price; }
+};
+
+// Prices kept as integer tick counts: exact comparisons and cheaper keys.
+struct TickPrice {
+    using type = int64_t;
+
+    static type from_double(double price) { return static_cast<type>(std::llround(price * 100.0)); }
+    static double to_double(type price) { return static_cast<double>(price) / 100.0; }
+};
+
+// Level containers. Both are ordered so that begin() is the best price for the
+// side's comparator, and both expose pair-like elements (first = price,
+// second = level value) so callers can iterate them the same way.
+
+template <typename Price, typename Value, typename Compare>
+using MapLevels = std::map<Price, Value, Compare>;
+
+// Whether a level's iterator survives inserts and erases of other levels.
+// The book caches such iterators per order so cancel and modify skip the
+// price lookup; containers without the guarantee are searched by price.
+template <typename Levels>
+struct stable_level_iterators : std::false_type {};
+
+template <typename Price, typename Value, typename Compare>
+struct stable_level_iterators<std::map<Price, Value, Compare>> : std::true_type {};
+
+// Sorted contiguous levels, stored worst price first so the touch sits at
+// the back of the vector: new best levels and levels emptied by fills are
+// push/pop at the end, and only changes deeper in the book shift elements.
+// Iteration runs back to front, so begin() is still the best price.
+template <typename Price, typename Value, typename Compare>
+class FlatLevels {
+public:
+    using key_type = Price;
+    using mapped_type = Value;
+    using value_type = std::pair<Price, Value>;
+    using key_compare = Compare;
+    using iterator = typename std::vector<value_type>::reverse_iterator;
+    using const_iterator = typename std::vector<value_type>::const_reverse_iterator;
+
+    iterator begin() { return levels.rbegin(); }
+    iterator end() { return levels.rend(); }
+    const_iterator begin() const { return levels.rbegin(); }
+    const_iterator end() const { return levels.rend(); }
+
+    bool empty() const { return levels.empty(); }
+    size_t size() const { return levels.size(); }
+    key_compare key_comp() const { return key_compare(); }
+
+    iterator find(const Price& price) {
+        auto it = position(price);
+        return (it != levels.end() && !comp(it->first, price)) ? iterator(it + 1) : end();
+    }
+
+    Value& operator[](const Price& price) {
+        auto it = position(price);
+        if (it == levels.end() || comp(it->first, price))
+            it = levels.emplace(it, price, Value{});
+        return it->second;
+    }
+
+    iterator erase(iterator it) {
+        return iterator(levels.erase(std::next(it).base()));
+    }
+
+private:
+    using storage_iterator = typename std::vector<value_type>::iterator;
+
+    // First stored level that is not worse than price.
+    storage_iterator position(const Price& price) {
+        return std::lower_bound(levels.begin(), levels.end(), price,
+            [this](const value_type& level, const Price& p) { return comp(p, level.first); });
+    }
+
+    std::vector<value_type> levels;
+    Compare comp;
+};
@@ -0,0 +1,98 @@
+#include "event_file.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+const char kMagic[8] = {'O', 'B', 'E', 'V', 'E', 'N', 'T', '1'};
+}
+
+Order RecordedEvent::to_order() const {
+    Order order{};
+    order.id = order_id;
+    order.price = price;
+    order.quantity = quantity;
+    order.is_bid = is_bid != 0;
+    order.type = static_cast<OrderType>(type);
+    order.timestamp = timestamp;
+    order.action = static_cast<OrderAction>(action);
+    order.account = account;
+    return order;
+}
+
+RecordedEvent RecordedEvent::from_order(const Order& order) {
+    RecordedEvent event{};
+    event.timestamp = order.timestamp;
+    event.order_id = order.id;
+    event.price = order.price;
+    event.quantity = order.quantity;
+    event.account = order.account;
+    event.is_bid = order.is_bid ? 1 : 0;
+    event.type = static_cast<uint8_t>(order.type);
+    event.action = static_cast<uint8_t>(order.action);
+    return event;
+}
+
+EventFile::~EventFile() {
+    close();
+}
+
+bool EventFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open event file " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(kMagic)) {
+        std::cerr << "Event file too short: " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+    size_t bytes = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "Failed to map event file " << path << std::endl;
+        return false;
+    }
+    if (std::memcmp(data, kMagic, sizeof(kMagic)) != 0 ||
+        (bytes - sizeof(kMagic)) % sizeof(RecordedEvent) != 0) {
+        std::cerr << "Not an event file: " << path << std::endl;
+        munmap(data, bytes);
+        return false;
+    }
+
+    mapping = data;
+    mapping_bytes = bytes;
+    records = reinterpret_cast<const RecordedEvent*>(static_cast<const char*>(data) + sizeof(kMagic));
+    count = (bytes - sizeof(kMagic)) / sizeof(RecordedEvent);
+    return true;
+}
+
+void EventFile::close() {
+    if (mapping)
+        munmap(mapping, mapping_bytes);
+    mapping = nullptr;
+    mapping_bytes = 0;
+    records = nullptr;
+    count = 0;
+}
+
+bool write_event_file(const std::string& path, const std::vector<RecordedEvent>& events) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(kMagic, sizeof(kMagic));
+    out.write(reinterpret_cast<const char*>(events.data()),
+              static_cast<std::streamsize>(events.size() * sizeof(RecordedEvent)));
+    if (!out) {
+        std::cerr << "Failed to write event file " << path << std::endl;
+        return false;
+    }
+    return true;
+}
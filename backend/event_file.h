@@ -0,0 +1,49 @@
+#pragma once
+
+#include "orderbook.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// One recorded order-flow event. Fixed-size and trivially copyable so a file
+// of them can be memory-mapped and read in place.
+struct RecordedEvent {
+    uint64_t timestamp;  // ms
+    uint64_t order_id;
+    double price;
+    double quantity;
+    uint32_t account;
+    uint8_t is_bid;
+    uint8_t type;        // OrderType
+    uint8_t action;      // OrderAction
+    uint8_t reserved;
+
+    Order to_order() const;
+    static RecordedEvent from_order(const Order& order);
+};
+static_assert(sizeof(RecordedEvent) == 40, "RecordedEvent is a file format");
+
+// Read-only, memory-mapped event file: an 8-byte magic followed by records.
+// The mapping is shared, so any number of threads can replay it at once.
+class EventFile {
+public:
+    EventFile() = default;
+    ~EventFile();
+
+    EventFile(const EventFile&) = delete;
+    EventFile& operator=(const EventFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const RecordedEvent* events() const { return records; }
+    size_t size() const { return count; }
+
+private:
+    void* mapping = nullptr;
+    size_t mapping_bytes = 0;
+    const RecordedEvent* records = nullptr;
+    size_t count = 0;
+};
+
+bool write_event_file(const std::string& path, const std::vector<RecordedEvent>& events);
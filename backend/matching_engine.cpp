@@ -4,12 +4,62 @@
 #endif
 #include <algorithm>
 
+namespace {
+
+// Ring and risk-table sizes for a live session; inline replay needs neither.
+constexpr size_t kRingCapacity = 65536;
+constexpr size_t kWorkingOrderReserve = 1 << 16;
+
+// Checks shared by the submit path and inline replay: new orders and amends
+// need a positive price and quantity; cancels and controls carry neither.
+bool is_valid(const Order& order) {
+    if (order.action != OrderAction::NEW && order.action != OrderAction::MODIFY)
+        return true;
+    return order.price > 0 && order.quantity > 0;
+}
+
+} // namespace
+
 MatchingEngine::MatchingEngine()
     : running(false),
-      processedOrders(0),
-      totalLatencyMs(0),
-      totalLatencyCount(0)
+      pendingOrders(0),
+      lastRejectReason(RiskReject::NONE),
+      submittedOrders(metrics.counter("orderbook_orders_submitted_total", "Orders and control messages queued for processing")),
+      processedOrders(metrics.counter("orderbook_orders_processed_total", "Orders and control messages processed by the matching thread")),
+      rejectedOrders(metrics.counter("orderbook_orders_rejected_total", "Orders rejected by pre-trade risk checks")),
+      executedTrades(metrics.counter("orderbook_trades_total", "Trades executed")),
+      auctionRejectedOrders(metrics.counter("orderbook_auction_rejected_total", "Market orders refused during a call auction")),
+      orderLatency(metrics.histogram("orderbook_order_latency_seconds", "Time from submission to the end of matching",
+                                     {1e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2, 0.1, 1.0})),
+      riskCheckTime(metrics.histogram("orderbook_risk_check_seconds", "Duration of one pre-trade risk check",
+                                      {5e-8, 1e-7, 2.5e-7, 5e-7, 1e-6, 1e-5, 1e-4})),
+      wakeupLatency(metrics.histogram("orderbook_wakeup_latency_seconds", "Risk-stage handoff to dequeue for orders that found the matching thread idle",
+                                      {1e-6, 5e-6, 1e-5, 5e-5, 1e-4, 5e-4, 1e-3, 1e-2})),
+      bidLevels(metrics.gauge("orderbook_bid_levels", "Price levels on the bid side")),
+      askLevels(metrics.gauge("orderbook_ask_levels", "Price levels on the ask side")),
+      orderRate(metrics.rate("orderbook_orders_per_second", "Processed orders per second over the last 5 s", processedOrders)),
+      tradeRate(metrics.rate("orderbook_trades_per_second", "Trades per second over the last 5 s", executedTrades)),
+      maxWakeupNs(0),
+      tradingPhase(TradingPhase::CONTINUOUS),
+      indicativePrice(0.0),
+      indicativeVolume(0.0),
+      lastUncrossPrice(0.0),
+      lastUncrossVolume(0.0)
 {
+    metrics.gauge_fn("orderbook_queue_depth", "Orders in the intake queue, waiting for the risk stage",
+                     [this]{ return static_cast<double>(pendingOrders.load()); });
+    metrics.gauge_fn("orderbook_match_queue_depth", "Risk-checked orders in the ring, waiting for the matching thread",
+                     [this]{ return static_cast<double>(risk_to_match.size()); });
+
+    order_book.set_trade_listener([this](const Trade& trade) {
+        executedTrades.add();
+        trade_store.append(trade);
+        report_execution(ExecutionReport{ExecutionReport::Kind::FILL, trade.taker_order_id, trade.price, trade.quantity});
+        report_execution(ExecutionReport{ExecutionReport::Kind::FILL, trade.maker_order_id, trade.price, trade.quantity});
+    });
+    order_book.set_filled_listener([this](uint64_t order_id) {
+        report_execution(ExecutionReport{ExecutionReport::Kind::CLOSED, order_id, 0.0, 0.0});
+    });
 #ifdef SPDLOG_H
     spdlog::info("MatchingEngine constructed.");
 #endif
@@ -19,84 +69,384 @@ MatchingEngine::~MatchingEngine() {
     stop();
 }
 
+void MatchingEngine::set_thread_config(const EngineThreadConfig& config) {
+    thread_config = config;
+}
+
+const EngineThreadConfig& MatchingEngine::get_thread_config() const {
+    return thread_config;
+}
+
+void MatchingEngine::set_risk_limits(const RiskLimits& limits) {
+    risk_checker.set_limits(limits);
+}
+
+void MatchingEngine::set_update_listener(std::function<void()> listener) {
+    update_listener = std::move(listener);
+}
+
+void MatchingEngine::set_delta_listener(std::function<void(const BookDelta&)> listener) {
+    order_book.set_delta_listener(std::move(listener));
+}
+
 void MatchingEngine::start() {
+    risk_to_match.allocate(kRingCapacity);
+    execution_reports.allocate(kRingCapacity);
+    risk_checker.reserve(kWorkingOrderReserve);
     running = true;
-    engineStartTime = std::chrono::steady_clock::now();
+    pipelined = true;
+    risk_thread = std::thread(&MatchingEngine::risk_stage_thread, this);
     engine_thread = std::thread(&MatchingEngine::matching_thread, this);
 }
 
 void MatchingEngine::stop() {
     running = false;
-    cv.notify_all();
+    queue_signal.notify_all();
+    match_signal.notify_all();
     if (engine_thread.joinable())
         engine_thread.join();
+    if (risk_thread.joinable())
+        risk_thread.join();
+    pipelined = false;
 }
 
 void MatchingEngine::submit_order(Order order) {  // Fix: Removed `const &` to allow modification
-    order.submit_time = std::chrono::steady_clock::now();
-    order.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
-        order.submit_time.time_since_epoch()).count());
+    if (!is_valid(order)) {
+        return;
+    }
+
+    enqueue(order);
+}
 
-    if (order.price <= 0 || order.quantity <= 0) {
+void MatchingEngine::submit_modify(uint64_t order_id, double new_price, double new_quantity) {
+    Order order{};
+    order.id = order_id;
+    order.price = new_price;
+    order.quantity = new_quantity;
+    order.action = OrderAction::MODIFY;
+    if (!is_valid(order)) {
         return;
     }
+    enqueue(order);
+}
+
+void MatchingEngine::submit_cancel(uint64_t order_id) {
+    Order order{};
+    order.id = order_id;
+    order.action = OrderAction::CANCEL;
+    enqueue(order);
+}
+
+void MatchingEngine::begin_call_auction() {
+    enqueue_control(OrderAction::AUCTION_CALL);
+}
+
+void MatchingEngine::uncross_auction() {
+    enqueue_control(OrderAction::AUCTION_UNCROSS);
+}
+
+void MatchingEngine::enqueue_control(OrderAction action) {
+    Order order{};
+    order.action = action;
+    enqueue(order);
+}
+
+// Every queued order and control message is stamped here, once: submit_time
+// (steady) for latency, timestamp (wall-clock ms since the Unix epoch) for
+// the book and trade history, so spilled runs line up with real time.
+void MatchingEngine::enqueue(Order order) {
+    order.submit_time = std::chrono::steady_clock::now();
+    order.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
 
     {
         std::lock_guard<std::mutex> lock(queue_mutex);
         order_queue.push(order);
     }
 
-    cv.notify_one();
+    pendingOrders.fetch_add(1);
+    submittedOrders.add();
+    queue_signal.notify();
 }
 
 OrderBook& MatchingEngine::get_order_book() {
     return order_book;
 }
 
+TradeStore& MatchingEngine::get_trade_store() {
+    return trade_store;
+}
+
+MetricsRegistry& MatchingEngine::get_metrics() {
+    return metrics;
+}
+
 uint64_t MatchingEngine::getProcessedOrderCount() const {
-    return processedOrders.load();
+    return processedOrders.value();
 }
 
 double MatchingEngine::getAverageLatencyMs() const {
-    uint64_t count = totalLatencyCount.load();
-    if (count == 0) return 0.0;
-
-    int64_t sumMs = totalLatencyMs.load();
-    return static_cast<double>(sumMs) / static_cast<double>(count);
+    return orderLatency.mean() * 1e3;
 }
 
 double MatchingEngine::getThroughputOps() const {
-    auto now = std::chrono::steady_clock::now();
-    double elapsedSec = std::chrono::duration_cast<std::chrono::seconds>(now - engineStartTime).count();
-    if (elapsedSec < 0.001) return 0.0;
+    return orderRate.per_second();
+}
 
-    return static_cast<double>(processedOrders.load()) / elapsedSec;
+double MatchingEngine::getTradeRate() const {
+    return tradeRate.per_second();
 }
 
-void MatchingEngine::matching_thread() {
-    while (running) {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        cv.wait(lock, [this]{ return !order_queue.empty() || !running; });
-        if (!running) break;
+double MatchingEngine::getAverageWakeupLatencyUs() const {
+    return wakeupLatency.mean() * 1e6;
+}
 
-        Order order = order_queue.front();
-        order_queue.pop();
-        lock.unlock();
+uint64_t MatchingEngine::getMaxWakeupLatencyNs() const {
+    return maxWakeupNs.load();
+}
+
+uint64_t MatchingEngine::getRejectedOrderCount() const {
+    return rejectedOrders.value();
+}
+
+RiskReject MatchingEngine::getLastRejectReason() const {
+    return lastRejectReason.load();
+}
+
+double MatchingEngine::getAverageRiskCheckNs() const {
+    return riskCheckTime.mean() * 1e9;
+}
 
+// Runs on the matching thread. The risk stage drains these before its next
+// check, so limits always see every fill that preceded the order under test.
+void MatchingEngine::report_execution(const ExecutionReport& report) {
+    if (!pipelined) {
+        risk_checker.on_report(report);
+        return;
+    }
+    while (!execution_reports.try_push(report)) {
+        if (!running) return;
+        queue_signal.notify();
+        cpu_relax();
+    }
+    queue_signal.notify();
+}
+
+void MatchingEngine::drain_execution_reports() {
+    ExecutionReport report;
+    while (execution_reports.try_pop(report))
+        risk_checker.on_report(report);
+}
+
+TradingPhase MatchingEngine::getTradingPhase() const {
+    return tradingPhase.load();
+}
+
+double MatchingEngine::getIndicativePrice() const {
+    return indicativePrice.load();
+}
+
+double MatchingEngine::getIndicativeVolume() const {
+    return indicativeVolume.load();
+}
+
+double MatchingEngine::getLastUncrossPrice() const {
+    return lastUncrossPrice.load();
+}
+
+double MatchingEngine::getLastUncrossVolume() const {
+    return lastUncrossVolume.load();
+}
+
+uint64_t MatchingEngine::getAuctionRejectedCount() const {
+    return auctionRejectedOrders.value();
+}
+
+void MatchingEngine::publish_indicative() {
+    AuctionResult indicative = order_book.indicative_uncross();
+    indicativePrice.store(indicative.price);
+    indicativeVolume.store(indicative.volume);
+    eventsSinceIndicative = 0;
+}
+
+void MatchingEngine::process_continuous(const Order& order) {
+    switch (order.action) {
+    case OrderAction::NEW: {
         // Perform matching
         double matchedVolume = order_book.match_order(order);
         if (matchedVolume < order.quantity) {
             Order remainingOrder = order;
             remainingOrder.quantity -= matchedVolume;
-            order_book.add_order(remainingOrder);
+            if (!order_book.add_order(remainingOrder))
+                report_execution(ExecutionReport{ExecutionReport::Kind::CLOSED, order.id, 0.0, 0.0});
+        } else {
+            // Filled on arrival, so it never rests and the book will not close it.
+            report_execution(ExecutionReport{ExecutionReport::Kind::CLOSED, order.id, 0.0, 0.0});
+        }
+        break;
+    }
+    case OrderAction::MODIFY:
+        if (!order_book.modify_order(order.id, order.price, order.quantity, order.timestamp))
+            report_execution(ExecutionReport{ExecutionReport::Kind::CLOSED, order.id, 0.0, 0.0});
+        break;
+    case OrderAction::CANCEL:
+        if (order_book.cancel_order(order.id, order.timestamp))
+            report_execution(ExecutionReport{ExecutionReport::Kind::CLOSED, order.id, 0.0, 0.0});
+        break;
+    default:
+        break;
+    }
+}
+
+void MatchingEngine::process_call_phase(const Order& order) {
+    switch (order.action) {
+    case OrderAction::NEW:
+        // Resting a market order at its nominal price would let that price
+        // set the equilibrium, so it is refused instead; the report releases
+        // what the risk stage counted as working.
+        if (order.type == OrderType::MARKET) {
+            auctionRejectedOrders.add();
+            report_execution(ExecutionReport{ExecutionReport::Kind::CLOSED, order.id, 0.0, 0.0});
+        } else if (!order_book.add_order(order)) {
+            report_execution(ExecutionReport{ExecutionReport::Kind::CLOSED, order.id, 0.0, 0.0});
+        }
+        break;
+    case OrderAction::MODIFY:
+        if (!order_book.modify_order(order.id, order.price, order.quantity, order.timestamp, false))
+            report_execution(ExecutionReport{ExecutionReport::Kind::CLOSED, order.id, 0.0, 0.0});
+        break;
+    case OrderAction::CANCEL:
+        if (order_book.cancel_order(order.id, order.timestamp))
+            report_execution(ExecutionReport{ExecutionReport::Kind::CLOSED, order.id, 0.0, 0.0});
+        break;
+    default:
+        break;
+    }
+
+    // The equilibrium search is O(crossed levels), so refresh it whenever the
+    // queue drains and at least every 64 events under sustained flow.
+    if (++eventsSinceIndicative >= 64 || risk_to_match.empty())
+        publish_indicative();
+}
+
+void MatchingEngine::dispatch(const Order& order) {
+    switch (order.action) {
+    case OrderAction::AUCTION_CALL:
+        tradingPhase.store(TradingPhase::CALL_AUCTION);
+        publish_indicative();
+        break;
+    case OrderAction::AUCTION_UNCROSS:
+        if (tradingPhase.load() == TradingPhase::CALL_AUCTION) {
+            AuctionResult result = order_book.uncross(order.timestamp);
+            lastUncrossPrice.store(result.price);
+            lastUncrossVolume.store(result.volume);
+            indicativePrice.store(0.0);
+            indicativeVolume.store(0.0);
+            tradingPhase.store(TradingPhase::CONTINUOUS);
+        }
+        break;
+    default:
+        if (tradingPhase.load() == TradingPhase::CALL_AUCTION)
+            process_call_phase(order);
+        else
+            process_continuous(order);
+        break;
+    }
+}
+
+RiskReject MatchingEngine::process_inline(const Order& order) {
+    if (!is_valid(order))
+        return RiskReject::INVALID_ORDER;
+    RiskReject reject = risk_checker.check(order);
+    if (reject != RiskReject::NONE) {
+        rejectedOrders.add();
+        lastRejectReason.store(reject);
+        return reject;
+    }
+    dispatch(order);
+    processedOrders.add();
+    return RiskReject::NONE;
+}
+
+// Pipeline stage between intake and matching: pre-trade checks against
+// risk state fed by the matching thread's execution reports.
+void MatchingEngine::risk_stage_thread() {
+    EngineThreadConfig riskConfig = thread_config;
+    riskConfig.cpu = thread_config.risk_cpu;
+    apply_thread_config(riskConfig);
+
+    while (running) {
+        queue_signal.wait(thread_config.wait_strategy, thread_config.spin_budget,
+                          [this]{ return pendingOrders.load() > 0 || !execution_reports.empty() || !running; });
+        if (!running) break;
+
+        drain_execution_reports();
+        if (pendingOrders.load() == 0)
+            continue;
+
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        Order order = order_queue.front();
+        order_queue.pop();
+        lock.unlock();
+        pendingOrders.fetch_sub(1);
+
+        auto checkStart = std::chrono::steady_clock::now();
+        RiskReject reject = risk_checker.check(order);
+        riskCheckTime.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - checkStart).count());
+        if (reject != RiskReject::NONE) {
+            rejectedOrders.add();
+            lastRejectReason.store(reject);
+            continue;
         }
 
+        CheckedOrder checked{order, std::chrono::steady_clock::now()};
+        // Keep draining reports while the ring is full so the matching
+        // thread, which may be blocked on the report ring, can progress.
+        while (!risk_to_match.try_push(checked)) {
+            if (!running) return;
+            drain_execution_reports();
+            cpu_relax();
+        }
+        match_signal.notify();
+    }
+}
+
+void MatchingEngine::matching_thread() {
+    apply_thread_config(thread_config);
+
+    while (running) {
+        bool wasIdle = risk_to_match.empty();
+        match_signal.wait(thread_config.wait_strategy, thread_config.spin_budget,
+                          [this]{ return !risk_to_match.empty() || !running; });
+        if (!running) break;
+
+        CheckedOrder checked;
+        risk_to_match.try_pop(checked);
+        const Order& order = checked.order;
+
+        // Only the risk -> matching hop: intake queueing and the risk check
+        // have their own metrics (queue depth, risk-check time).
+        if (wasIdle) {
+            auto wakeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - checked.handoff_time).count();
+            wakeupLatency.observe(wakeNs * 1e-9);
+            uint64_t prevMax = maxWakeupNs.load();
+            while (static_cast<uint64_t>(wakeNs) > prevMax &&
+                   !maxWakeupNs.compare_exchange_weak(prevMax, static_cast<uint64_t>(wakeNs))) {
+            }
+        }
+
+        dispatch(order);
+
         // Compute latency
         auto endTime = std::chrono::steady_clock::now();
-        auto latencyMs = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - order.submit_time).count();
-        totalLatencyMs.fetch_add(static_cast<int64_t>(latencyMs));
-        totalLatencyCount.fetch_add(1);
+        orderLatency.observe(std::chrono::duration<double>(endTime - order.submit_time).count());
+        bidLevels.set(static_cast<double>(order_book.get_bids().size()));
+        askLevels.set(static_cast<double>(order_book.get_asks().size()));
+
+        processedOrders.add();
 
-        processedOrders.fetch_add(1);
+        if (update_listener)
+            update_listener();
     }
 }
\ No newline at end of file
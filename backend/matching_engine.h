@@ -1,41 +1,149 @@
 #pragma once
 
 #include "orderbook.h"
+#include "wait_strategy.h"
+#include "trade_store.h"
+#include "risk_check.h"
+#include "spsc_queue.h"
+#include "metrics.h"
 #include <queue>
 #include <atomic>
 #include <thread>
 #include <condition_variable>
 #include <chrono>
+#include <functional>
+
+enum class TradingPhase { CONTINUOUS, CALL_AUCTION };
 
 class MatchingEngine {
 public:
     MatchingEngine();
     ~MatchingEngine();
 
+    // Must be called before start().
+    void set_thread_config(const EngineThreadConfig& config);
+    const EngineThreadConfig& get_thread_config() const;
+    void set_risk_limits(const RiskLimits& limits);
+    // Called on the matching thread after every processed order. It sits on
+    // the hot path, so listeners should only flag work for another thread.
+    void set_update_listener(std::function<void()> listener);
+    // Level deltas from every add, fill, cancel, modify and uncross, emitted
+    // on the matching thread in book order (quantity 0 removes the level).
+    // Applying them in order to an initially empty book reproduces it.
+    void set_delta_listener(std::function<void(const BookDelta&)> listener);
+
     void start();
     void stop();
     
     void submit_order(Order order);  // Fix: Removed `const &` to allow modifications
+    // Queued behind earlier orders, so an amend never overtakes the order it targets.
+    void submit_modify(uint64_t order_id, double new_price, double new_quantity);
+    void submit_cancel(uint64_t order_id);
+
+    // Call auction. During the call phase limit orders rest without matching
+    // and an indicative price/volume is republished as the book changes.
+    // Market orders carry no usable price for the equilibrium, so they are
+    // refused until the auction ends (see getAuctionRejectedCount); uncrossing
+    // executes everything at the equilibrium price and resumes continuous
+    // trading. Both are queued, so they take effect in order-flow sequence.
+    void begin_call_auction();
+    void uncross_auction();
+    TradingPhase getTradingPhase() const;
+    double getIndicativePrice() const;
+    double getIndicativeVolume() const;
+    double getLastUncrossPrice() const;
+    double getLastUncrossVolume() const;
+    uint64_t getAuctionRejectedCount() const;
+
+    // Runs one order (or control action) through risk and matching on the
+    // calling thread, keeping its timestamp. For replay and backtesting: the
+    // engine must not be started, and nothing here reads the clock, so the
+    // same input always produces the same book and trades. Orders the submit
+    // path would drop (non-positive price or quantity) return INVALID_ORDER.
+    RiskReject process_inline(const Order& order);
 
     OrderBook& get_order_book();
+    // Every executed trade, kept for charting and offline analysis.
+    TradeStore& get_trade_store();
+    // Engine counters, gauges and histograms; read by the GUI and served by
+    // MetricsServer. The getters below are views onto the same metrics.
+    MetricsRegistry& get_metrics();
     
     uint64_t getProcessedOrderCount() const;
     double getAverageLatencyMs() const;
-    double getThroughputOps() const;
+    double getThroughputOps() const;  // Orders/sec over the last few seconds
+    double getTradeRate() const;      // Trades/sec over the last few seconds
+    // Submit-to-dequeue time of orders that found the engine thread idle,
+    // i.e. the cost of waking it under the configured wait strategy.
+    double getAverageWakeupLatencyUs() const;
+    uint64_t getMaxWakeupLatencyNs() const;
+
+    // Pre-trade risk stage
+    uint64_t getRejectedOrderCount() const;
+    RiskReject getLastRejectReason() const;
+    double getAverageRiskCheckNs() const;
 
 private:
     void matching_thread();
+    void risk_stage_thread();
+    void drain_execution_reports();
+    void report_execution(const ExecutionReport& report);
+    void enqueue(Order order);
+    void enqueue_control(OrderAction action);
+    void dispatch(const Order& order);
+    void process_continuous(const Order& order);
+    void process_call_phase(const Order& order);
+    void publish_indicative();
 
     OrderBook order_book;
+    TradeStore trade_store;
     std::atomic<bool> running;
+    bool pipelined = false;  // Risk stage thread is running (set/cleared around start/stop)
     std::thread engine_thread;
+    std::thread risk_thread;
+    EngineThreadConfig thread_config;
+    std::function<void()> update_listener;
+
+    // Intake -> risk stage: any submitting thread may push, so this hop
+    // keeps the mutex; risk -> matching and matching -> risk are SPSC rings,
+    // allocated by start() so inline-only engines (backtests) stay small.
     std::queue<Order> order_queue;
     std::mutex queue_mutex;
-    std::condition_variable cv;
-    std::atomic<uint64_t> processedOrders;
+    std::atomic<size_t> pendingOrders;
+    WaitSignal queue_signal;  // Wakes the risk stage (orders or reports)
+    struct CheckedOrder {
+        Order order;
+        std::chrono::steady_clock::time_point handoff_time;  // Pushed by the risk stage
+    };
+    SpscQueue<CheckedOrder> risk_to_match;
+    WaitSignal match_signal;  // Wakes the matching thread
+    SpscQueue<ExecutionReport> execution_reports;
+
+    RiskChecker risk_checker;  // Risk stage thread only while pipelined
+    std::atomic<RiskReject> lastRejectReason;
+
+    // Metrics. Each writer thread updates its own shard, so the risk and
+    // matching threads no longer share counter cache lines.
+    MetricsRegistry metrics;
+    Counter& submittedOrders;
+    Counter& processedOrders;
+    Counter& rejectedOrders;
+    Counter& executedTrades;
+    Counter& auctionRejectedOrders;
+    Histogram& orderLatency;   // Seconds, submit to processed
+    Histogram& riskCheckTime;  // Seconds per pre-trade check
+    Histogram& wakeupLatency;  // Seconds from risk handoff, for orders that found the matching thread idle
+    Gauge& bidLevels;
+    Gauge& askLevels;
+    RateWindow& orderRate;
+    RateWindow& tradeRate;
+    std::atomic<uint64_t> maxWakeupNs;
 
-    // Latency & Throughput Tracking
-    std::atomic<int64_t> totalLatencyMs;
-    std::atomic<uint64_t> totalLatencyCount;
-    std::chrono::steady_clock::time_point engineStartTime;
+    // Call auction state
+    std::atomic<TradingPhase> tradingPhase;
+    std::atomic<double> indicativePrice;
+    std::atomic<double> indicativeVolume;
+    std::atomic<double> lastUncrossPrice;
+    std::atomic<double> lastUncrossVolume;
+    uint32_t eventsSinceIndicative = 0;  // Engine thread only
 };
\ No newline at end of file
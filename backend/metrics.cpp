@@ -0,0 +1,174 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+size_t metric_shard() {
+    static std::atomic<size_t> nextShard{0};
+    thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const Cell& cell : cells)
+        total += cell.value.load(std::memory_order_relaxed);
+    return total;
+}
+
+Histogram::Histogram(std::vector<double> upperBounds)
+    : bounds(std::move(upperBounds))
+{
+    std::sort(bounds.begin(), bounds.end());
+    if (bounds.size() > kMaxBuckets)
+        bounds.resize(kMaxBuckets);
+}
+
+void Histogram::observe(double v) {
+    size_t bucket = std::lower_bound(bounds.begin(), bounds.end(), v) - bounds.begin();
+    Shard& shard = shards[metric_shard()];
+    shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    // Threads sharing a shard are rare, so this almost never retries.
+    double sum = shard.sum.load(std::memory_order_relaxed);
+    while (!shard.sum.compare_exchange_weak(sum, sum + v, std::memory_order_relaxed)) {
+    }
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snap;
+    snap.bounds = bounds;
+    snap.counts.assign(bounds.size() + 1, 0);
+    for (const Shard& shard : shards) {
+        for (size_t b = 0; b <= bounds.size(); ++b)
+            snap.counts[b] += shard.counts[b].load(std::memory_order_relaxed);
+        snap.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    for (uint64_t c : snap.counts)
+        snap.count += c;
+    return snap;
+}
+
+double Histogram::mean() const {
+    uint64_t count = 0;
+    double sum = 0.0;
+    for (const Shard& shard : shards) {
+        for (size_t b = 0; b <= bounds.size(); ++b)
+            count += shard.counts[b].load(std::memory_order_relaxed);
+        sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    return count == 0 ? 0.0 : sum / static_cast<double>(count);
+}
+
+RateWindow::RateWindow(const Counter& source, std::chrono::milliseconds window)
+    : source(source), window(window)
+{
+    samples.push_back(Sample{std::chrono::steady_clock::now(), source.value()});
+}
+
+double RateWindow::per_second() const {
+    auto now = std::chrono::steady_clock::now();
+    uint64_t current = source.value();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    // At most one sample per 1/16 window keeps the history short under
+    // frequent reads; keep one sample older than the window as its start.
+    if (now - samples.back().time >= window / 16)
+        samples.push_back(Sample{now, current});
+    while (samples.size() > 2 && now - samples[1].time >= window)
+        samples.pop_front();
+
+    double elapsed = std::chrono::duration<double>(now - samples.front().time).count();
+    if (elapsed <= 0.0)
+        return 0.0;
+    return static_cast<double>(current - samples.front().value) / elapsed;
+}
+
+MetricsRegistry::Entry& MetricsRegistry::add(const std::string& name, const std::string& help, Kind kind) {
+    std::lock_guard<std::mutex> lock(mtx);
+    entries.emplace_back();
+    Entry& entry = entries.back();
+    entry.name = name;
+    entry.help = help;
+    entry.kind = kind;
+    return entry;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help) {
+    Entry& entry = add(name, help, Kind::COUNTER);
+    entry.counter = std::make_unique<Counter>();
+    return *entry.counter;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help) {
+    Entry& entry = add(name, help, Kind::GAUGE);
+    entry.gauge = std::make_unique<Gauge>();
+    return *entry.gauge;
+}
+
+void MetricsRegistry::gauge_fn(const std::string& name, const std::string& help, std::function<double()> read) {
+    Entry& entry = add(name, help, Kind::GAUGE_FN);
+    entry.read = std::move(read);
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, std::vector<double> bounds) {
+    Entry& entry = add(name, help, Kind::HISTOGRAM);
+    entry.histogram = std::make_unique<Histogram>(std::move(bounds));
+    return *entry.histogram;
+}
+
+RateWindow& MetricsRegistry::rate(const std::string& name, const std::string& help, const Counter& source,
+                                  std::chrono::milliseconds window) {
+    Entry& entry = add(name, help, Kind::RATE);
+    entry.rate = std::make_unique<RateWindow>(source, window);
+    return *entry.rate;
+}
+
+namespace {
+
+std::string format_value(double v) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", v);
+    return buffer;
+}
+
+} // namespace
+
+std::string MetricsRegistry::render_prometheus() const {
+    std::ostringstream out;
+    std::lock_guard<std::mutex> lock(mtx);
+    for (const Entry& entry : entries) {
+        const char* type = entry.kind == Kind::COUNTER ? "counter"
+                         : entry.kind == Kind::HISTOGRAM ? "histogram" : "gauge";
+        out << "# HELP " << entry.name << ' ' << entry.help << '\n';
+        out << "# TYPE " << entry.name << ' ' << type << '\n';
+
+        switch (entry.kind) {
+        case Kind::COUNTER:
+            out << entry.name << ' ' << entry.counter->value() << '\n';
+            break;
+        case Kind::GAUGE:
+            out << entry.name << ' ' << format_value(entry.gauge->value()) << '\n';
+            break;
+        case Kind::GAUGE_FN:
+            out << entry.name << ' ' << format_value(entry.read()) << '\n';
+            break;
+        case Kind::RATE:
+            out << entry.name << ' ' << format_value(entry.rate->per_second()) << '\n';
+            break;
+        case Kind::HISTOGRAM: {
+            Histogram::Snapshot snap = entry.histogram->snapshot();
+            uint64_t cumulative = 0;
+            for (size_t b = 0; b < snap.bounds.size(); ++b) {
+                cumulative += snap.counts[b];
+                out << entry.name << "_bucket{le=\"" << format_value(snap.bounds[b]) << "\"} " << cumulative << '\n';
+            }
+            out << entry.name << "_bucket{le=\"+Inf\"} " << snap.count << '\n';
+            out << entry.name << "_sum " << format_value(snap.sum) << '\n';
+            out << entry.name << "_count " << snap.count << '\n';
+            break;
+        }
+        }
+    }
+    return out.str();
+}
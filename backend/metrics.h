@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Writer threads are spread over a fixed set of shards; each shard sits on
+// its own cache line, so hot-path updates are uncontended relaxed atomics and
+// the cost of summing shards is paid only by whoever reads the metric.
+constexpr size_t kMetricShards = 16;
+
+// Stable per-thread shard, assigned round-robin on a thread's first update.
+size_t metric_shard();
+
+class Counter {
+public:
+    void add(uint64_t n = 1) {
+        cells[metric_shard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Cell, kMetricShards> cells;
+};
+
+// A level rather than a sum, so a single value: last writer wins.
+class Gauge {
+public:
+    void set(double v) { current.store(v, std::memory_order_relaxed); }
+    double value() const { return current.load(std::memory_order_relaxed); }
+
+private:
+    alignas(64) std::atomic<double> current{0.0};
+};
+
+// Fixed upper bounds, cumulative only when exported.
+class Histogram {
+public:
+    static constexpr size_t kMaxBuckets = 24;
+
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double v);
+
+    struct Snapshot {
+        std::vector<double> bounds;
+        std::vector<uint64_t> counts;  // Per bucket, plus one for +Inf
+        uint64_t count = 0;
+        double sum = 0.0;
+    };
+    Snapshot snapshot() const;
+    double mean() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> counts[kMaxBuckets + 1];
+        std::atomic<double> sum{0.0};
+        Shard() {
+            for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    std::vector<double> bounds;
+    std::array<Shard, kMetricShards> shards;
+};
+
+// Per-second rate of a counter over a trailing window. Samples are taken
+// when the rate is read, so nothing runs in the background.
+class RateWindow {
+public:
+    RateWindow(const Counter& source, std::chrono::milliseconds window);
+
+    double per_second() const;
+
+private:
+    struct Sample {
+        std::chrono::steady_clock::time_point time;
+        uint64_t value;
+    };
+
+    const Counter& source;
+    std::chrono::milliseconds window;
+    mutable std::mutex mtx;
+    mutable std::deque<Sample> samples;
+};
+
+// Owns every metric and renders them in Prometheus text format. Metrics are
+// registered once at setup; references stay valid for the registry's life.
+class MetricsRegistry {
+public:
+    Counter& counter(const std::string& name, const std::string& help);
+    Gauge& gauge(const std::string& name, const std::string& help);
+    // Evaluated on read, for values another component already tracks.
+    void gauge_fn(const std::string& name, const std::string& help, std::function<double()> read);
+    Histogram& histogram(const std::string& name, const std::string& help, std::vector<double> bounds);
+    RateWindow& rate(const std::string& name, const std::string& help, const Counter& source,
+                     std::chrono::milliseconds window = std::chrono::seconds(5));
+
+    std::string render_prometheus() const;
+
+private:
+    enum class Kind { COUNTER, GAUGE, GAUGE_FN, HISTOGRAM, RATE };
+
+    struct Entry {
+        std::string name;
+        std::string help;
+        Kind kind;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::function<double()> read;
+        std::unique_ptr<Histogram> histogram;
+        std::unique_ptr<RateWindow> rate;
+    };
+
+    Entry& add(const std::string& name, const std::string& help, Kind kind);
+
+    mutable std::mutex mtx;
+    std::deque<Entry> entries;
+};
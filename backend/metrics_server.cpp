@@ -0,0 +1,121 @@
+#include "metrics_server.h"
+#include <iostream>
+#include <string>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+MetricsServer::MetricsServer(const MetricsRegistry& registry)
+    : registry(registry), running(false)
+{
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start(uint16_t requestedPort) {
+    stop();
+
+    listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cerr << "Metrics server: socket() failed" << std::endl;
+        return false;
+    }
+    int reuse = 1;
+    ::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Loopback only: the endpoint is for a local scraper, not the network.
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(requestedPort);
+    if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        ::listen(listen_fd, 8) < 0) {
+        std::cerr << "Metrics server: cannot listen on 127.0.0.1:" << requestedPort << std::endl;
+        ::close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+
+    socklen_t len = sizeof(addr);
+    ::getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    port = ntohs(addr.sin_port);
+
+    running = true;
+    server_thread = std::thread(&MetricsServer::serve, this);
+    return true;
+}
+
+void MetricsServer::stop() {
+    running = false;
+    if (server_thread.joinable())
+        server_thread.join();
+    if (listen_fd >= 0) {
+        ::close(listen_fd);
+        listen_fd = -1;
+    }
+}
+
+uint16_t MetricsServer::get_port() const {
+    return port;
+}
+
+void MetricsServer::serve() {
+    while (running) {
+        // Short poll so stop() never waits long on an idle socket.
+        pollfd pfd{listen_fd, POLLIN, 0};
+        if (::poll(&pfd, 1, 200) <= 0)
+            continue;
+        int client = ::accept(listen_fd, nullptr, nullptr);
+        if (client < 0)
+            continue;
+        handle(client);
+        ::close(client);
+    }
+}
+
+void MetricsServer::handle(int client) {
+    // Only the request line matters; read until the header ends, bounded in
+    // size and time so a stalled client cannot hold the server.
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        pollfd pfd{client, POLLIN, 0};
+        if (::poll(&pfd, 1, 1000) <= 0)
+            return;
+        ssize_t n = ::recv(client, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+            break;
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    std::string status;
+    std::string body;
+    std::string contentType = "text/plain; charset=utf-8";
+    if (request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET /metrics?", 0) == 0) {
+        status = "200 OK";
+        body = registry.render_prometheus();
+        contentType = "text/plain; version=0.0.4; charset=utf-8";
+    } else if (request.rfind("GET ", 0) == 0) {
+        status = "404 Not Found";
+        body = "Try /metrics\n";
+    } else {
+        status = "405 Method Not Allowed";
+        body = "Only GET is supported\n";
+    }
+
+    std::string response = "HTTP/1.0 " + status + "\r\n"
+                           "Content-Type: " + contentType + "\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = ::send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            break;
+        sent += static_cast<size_t>(n);
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "metrics.h"
+#include <atomic>
+#include <thread>
+#include <cstdint>
+
+// Minimal HTTP/1.0 server for Prometheus scrapes: GET /metrics on
+// 127.0.0.1 returns the registry in text exposition format. One connection
+// at a time on its own thread; it never touches engine threads directly.
+class MetricsServer {
+public:
+    explicit MetricsServer(const MetricsRegistry& registry);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // Port 0 picks a free port; see get_port().
+    bool start(uint16_t port);
+    void stop();
+    uint16_t get_port() const;
+
+private:
+    void serve();
+    void handle(int client);
+
+    const MetricsRegistry& registry;
+    std::atomic<bool> running;
+    std::thread server_thread;
+    int listen_fd = -1;
+    uint16_t port = 0;
+};
@@ -1,77 +1,407 @@
 #include "orderbook.h"
 
-void OrderBook::add_order(const Order& order) {
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+bool BasicOrderBook<PricePolicy, LevelMap>::add_order(const Order& order) {
     std::lock_guard<std::mutex> lock(mtx);
-    double roundedPrice = std::round(order.price * 100.0) / 100.0;
+    return add_locked(order);
+}
+
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+bool BasicOrderBook<PricePolicy, LevelMap>::add_locked(const Order& order) {
+    // The index holds one entry per live id; overwriting it would point
+    // cancel/modify at the wrong order.
+    if (order_index.find(order.id) != order_index.end())
+        return false;
+
+    price_type roundedPrice = PricePolicy::from_double(order.price);
+    auto rest = [&](auto side) {
+        constexpr bool IsBid = decltype(side)::value;
+        auto& levels = side_levels<IsBid>();
+        OrderRef ref{IsBid, roundedPrice, {}, {}, {}};
+        PriceLevel* level;
+        if constexpr (stable_level_iterators<std::remove_reference_t<decltype(levels)>>::value) {
+            auto it = levels.try_emplace(roundedPrice).first;
+            if constexpr (IsBid) ref.bid_level = it; else ref.ask_level = it;
+            level = &it->second;
+        } else {
+            level = &levels[roundedPrice];
+        }
+        level->quantity += order.quantity;
+        ref.position = level->orders.insert(level->orders.end(),
+                                             RestingOrder{order.id, order.quantity, order.timestamp});
+        order_index.emplace(order.id, ref);
+        record_delta(order.timestamp, IsBid, roundedPrice, level->quantity);
+    };
     if (order.is_bid) {
-        bids[roundedPrice] += order.quantity;
+        rest(std::true_type{});
     } else {
-        asks[roundedPrice] += order.quantity;
+        rest(std::false_type{});
     }
+    return true;
+}
+
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+bool BasicOrderBook<PricePolicy, LevelMap>::cancel_order(uint64_t order_id, uint64_t timestamp) {
+    std::lock_guard<std::mutex> lock(mtx);
+    return cancel_locked(order_id, timestamp);
 }
 
-void OrderBook::cancel_order(uint64_t /*order_id*/) {
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+bool BasicOrderBook<PricePolicy, LevelMap>::cancel_locked(uint64_t order_id, uint64_t timestamp) {
+    auto found = order_index.find(order_id);
+    if (found == order_index.end())
+        return false;
+    OrderRef ref = found->second;
+    order_index.erase(found);
+
+    auto remove = [&](auto side) {
+        constexpr bool IsBid = decltype(side)::value;
+        auto it = level_of<IsBid>(ref);
+        PriceLevel& level = it->second;
+        level.quantity -= ref.position->quantity;
+        level.orders.erase(ref.position);
+        if (level.orders.empty()) {
+            side_levels<IsBid>().erase(it);
+            record_delta(timestamp, ref.is_bid, ref.price, 0.0);
+        } else {
+            record_delta(timestamp, ref.is_bid, ref.price, level.quantity);
+        }
+    };
+    if (ref.is_bid) {
+        remove(std::true_type{});
+    } else {
+        remove(std::false_type{});
+    }
+    return true;
 }
 
-const std::map<double, double, std::greater<double>>& OrderBook::get_bids() const {
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+bool BasicOrderBook<PricePolicy, LevelMap>::modify_order(uint64_t order_id, double new_price, double new_quantity, uint64_t timestamp,
+                                                   bool allow_match) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto found = order_index.find(order_id);
+    if (found == order_index.end())
+        return false;
+    if (new_quantity <= 0)
+        return cancel_locked(order_id, timestamp);
+
+    OrderRef& ref = found->second;
+    price_type newPrice = PricePolicy::from_double(new_price);
+
+    // Same price and no size increase: amend in place, keep queue position.
+    if (newPrice == ref.price && new_quantity <= ref.position->quantity) {
+        auto shrink = [&](auto side) {
+            PriceLevel& level = level_of<decltype(side)::value>(ref)->second;
+            level.quantity -= ref.position->quantity - new_quantity;
+            ref.position->quantity = new_quantity;
+            record_delta(timestamp, ref.is_bid, ref.price, level.quantity);
+        };
+        if (ref.is_bid) {
+            shrink(std::true_type{});
+        } else {
+            shrink(std::false_type{});
+        }
+        return true;
+    }
+
+    // Otherwise lose priority: pull the order and re-enter it as a fresh limit.
+    Order amended{};
+    amended.id = order_id;
+    amended.price = new_price;
+    amended.quantity = new_quantity;
+    amended.is_bid = ref.is_bid;
+    amended.type = OrderType::LIMIT;
+    amended.timestamp = timestamp;
+    cancel_locked(order_id, timestamp);
+
+    double matchedVolume = allow_match ? match_locked(amended) : 0.0;
+    if (matchedVolume < amended.quantity) {
+        amended.quantity -= matchedVolume;
+        add_locked(amended);
+    } else {
+        record_filled(order_id);
+    }
+    return true;
+}
+
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+auto BasicOrderBook<PricePolicy, LevelMap>::get_bids() const -> const BidLevels& {
     return bids;
 }
 
-const std::map<double, double>& OrderBook::get_asks() const {
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+auto BasicOrderBook<PricePolicy, LevelMap>::get_asks() const -> const AskLevels& {
     return asks;
 }
 
-std::vector<OrderBook::Trade> OrderBook::get_trades() {
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+std::vector<Trade> BasicOrderBook<PricePolicy, LevelMap>::get_trades() {
     std::lock_guard<std::mutex> lock(mtx);
     auto copy = trades;
     trades.clear();
     return copy;
 }
 
-double OrderBook::match_order(const Order& order) {
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+void BasicOrderBook<PricePolicy, LevelMap>::set_trade_listener(std::function<void(const Trade&)> listener) {
     std::lock_guard<std::mutex> lock(mtx);
-    double tradedVolume = 0.0;
+    trade_listener = std::move(listener);
+}
+
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+void BasicOrderBook<PricePolicy, LevelMap>::record_trade(const Trade& trade) {
+    trades.push_back(trade);
+    if (trade_listener)
+        trade_listener(trade);
+}
+
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+void BasicOrderBook<PricePolicy, LevelMap>::set_delta_listener(std::function<void(const BookDelta&)> listener) {
+    std::lock_guard<std::mutex> lock(mtx);
+    delta_listener = std::move(listener);
+}
+
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+void BasicOrderBook<PricePolicy, LevelMap>::record_delta(uint64_t timestamp, bool is_bid, price_type price, double quantity) {
+    if (delta_listener)
+        delta_listener(BookDelta{timestamp, is_bid, PricePolicy::to_double(price), quantity});
+}
+
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+void BasicOrderBook<PricePolicy, LevelMap>::set_filled_listener(std::function<void(uint64_t)> listener) {
+    std::lock_guard<std::mutex> lock(mtx);
+    filled_listener = std::move(listener);
+}
+
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+void BasicOrderBook<PricePolicy, LevelMap>::record_filled(uint64_t order_id) {
+    if (filled_listener)
+        filled_listener(order_id);
+}
+
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+double BasicOrderBook<PricePolicy, LevelMap>::match_order(const Order& order) {
+    std::lock_guard<std::mutex> lock(mtx);
+    return match_locked(order);
+}
 
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+double BasicOrderBook<PricePolicy, LevelMap>::match_locked(const Order& order) {
+    price_type limit = PricePolicy::from_double(order.price);
+
+    // Resolve side and order type once; the loops below are branch-free on both.
     if (order.is_bid) {
-        while (!asks.empty() && tradedVolume < order.quantity) {
-            double askPrice = asks.begin()->first;
-            if (order.type == OrderType::LIMIT && order.price < askPrice)
+        return order.type == OrderType::MARKET ? match_side<true, true>(order, limit)
+                                               : match_side<true, false>(order, limit);
+    }
+    return order.type == OrderType::MARKET ? match_side<false, true>(order, limit)
+                                           : match_side<false, false>(order, limit);
+}
+
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+template <bool IsBid, bool IsMarket>
+double BasicOrderBook<PricePolicy, LevelMap>::match_side(const Order& order, price_type limit) {
+    auto& levels = side_levels<!IsBid>();
+    const auto better = levels.key_comp();
+    double tradedVolume = 0.0;
+
+    while (!levels.empty() && tradedVolume < order.quantity) {
+        auto it = levels.begin();
+        // A limit order stops once the resting side's best price is better
+        // (by that side's ordering) than the order's limit.
+        if constexpr (!IsMarket) {
+            if (better(limit, it->first))
                 break;
-            auto it = asks.begin();
-            double available = it->second;
-            double volume = std::min(order.quantity - tradedVolume, available);
-            tradedVolume += volume;
-            it->second -= volume;
-            Trade trade;
-            trade.timestamp = order.timestamp;
-            trade.price = it->first;
-            trade.quantity = volume;
-            trade.taker_order_id = order.id;
-            trade.maker_order_id = 0;
-            trades.push_back(trade);
-            if (it->second <= 0)
-                asks.erase(it);
         }
+        const RestingOrder& maker = it->second.orders.front();
+        double volume = std::min(order.quantity - tradedVolume, maker.quantity);
+        tradedVolume += volume;
+        Trade trade;
+        trade.timestamp = order.timestamp;
+        trade.price = PricePolicy::to_double(it->first);
+        trade.quantity = volume;
+        trade.taker_order_id = order.id;
+        trade.maker_order_id = maker.id;
+        record_trade(trade);
+        consume_front<!IsBid>(volume, order.timestamp);
+    }
+    return tradedVolume;
+}
+
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+template <bool IsBid>
+void BasicOrderBook<PricePolicy, LevelMap>::consume_front(double volume, uint64_t timestamp,
+                                                          std::vector<uint64_t>* filled_ids) {
+    auto& levels = side_levels<IsBid>();
+    auto it = levels.begin();
+    PriceLevel& level = it->second;
+    RestingOrder& front = level.orders.front();
+    front.quantity -= volume;
+    level.quantity -= volume;
+    if (front.quantity <= 0) {
+        if (filled_ids) {
+            filled_ids->push_back(front.id);
+        } else {
+            order_index.erase(front.id);
+            record_filled(front.id);
+        }
+        level.orders.pop_front();
+    }
+    if (level.orders.empty()) {
+        record_delta(timestamp, IsBid, it->first, 0.0);
+        levels.erase(it);
     } else {
-        while (!bids.empty() && tradedVolume < order.quantity) {
-            double bidPrice = bids.begin()->first;
-            if (order.type == OrderType::LIMIT && order.price > bidPrice)
-                break;
-            auto it = bids.begin();
-            double available = it->second;
-            double volume = std::min(order.quantity - tradedVolume, available);
-            tradedVolume += volume;
-            it->second -= volume;
-            Trade trade;
-            trade.timestamp = order.timestamp;
-            trade.price = it->first;
-            trade.quantity = volume;
-            trade.taker_order_id = order.id;
-            trade.maker_order_id = 0;
-            trades.push_back(trade);
-            if (it->second <= 0)
-                bids.erase(it);
+        record_delta(timestamp, IsBid, it->first, level.quantity);
+    }
+}
+
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+AuctionResult BasicOrderBook<PricePolicy, LevelMap>::indicative_uncross() {
+    std::lock_guard<std::mutex> lock(mtx);
+    price_type equilibriumPrice{};
+    return equilibrium_locked(equilibriumPrice);
+}
+
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+AuctionResult BasicOrderBook<PricePolicy, LevelMap>::equilibrium_locked(price_type& equilibrium_price) {
+    AuctionResult result;
+    if (bids.empty() || asks.empty())
+        return result;
+    const price_type bestBid = bids.begin()->first;
+    const price_type bestAsk = asks.begin()->first;
+    if (bestBid < bestAsk)
+        return result;
+
+    // Only levels inside [bestAsk, bestBid] can trade: demand at any candidate
+    // price counts bids >= bestAsk and supply counts asks <= bestBid. Merge
+    // those levels into one ascending price array.
+    auction_bids.clear();
+    auction_points.clear();
+    double totalBid = 0.0;
+    for (auto it = bids.begin(); it != bids.end() && !(it->first < bestAsk); ++it) {
+        auction_bids.push_back(AuctionPoint{it->first, it->second.quantity, 0.0});
+        totalBid += it->second.quantity;
+    }
+    size_t b = auction_bids.size();  // auction_bids is descending; merge from its back
+    auto a = asks.begin();
+    while (true) {
+        bool haveAsk = a != asks.end() && !(bestBid < a->first);
+        if (b == 0 && !haveAsk)
+            break;
+        if (!haveAsk || (b > 0 && auction_bids[b - 1].price < a->first)) {
+            auction_points.push_back(auction_bids[--b]);
+        } else if (b == 0 || a->first < auction_bids[b - 1].price) {
+            auction_points.push_back(AuctionPoint{a->first, 0.0, a->second.quantity});
+            ++a;
+        } else {
+            auction_points.push_back(AuctionPoint{a->first, auction_bids[--b].bid_quantity, a->second.quantity});
+            ++a;
         }
     }
-    return tradedVolume;
-}
\ No newline at end of file
+
+    // One ascending pass: supply is a running prefix over asks, demand the
+    // remaining suffix over bids. Maximize volume, then minimize |surplus|;
+    // on a full tie prefer the higher price when buyers are left over and
+    // the lower one when sellers are.
+    double demand = totalBid;
+    double supply = 0.0;
+    for (const AuctionPoint& point : auction_points) {
+        supply += point.ask_quantity;
+        double volume = std::min(demand, supply);
+        double surplus = demand - supply;
+        bool better = volume > result.volume ||
+            (volume == result.volume && volume > 0 &&
+             (std::abs(surplus) < std::abs(result.surplus) ||
+              (std::abs(surplus) == std::abs(result.surplus) && surplus > 0)));
+        if (better) {
+            result.price = PricePolicy::to_double(point.price);
+            result.volume = volume;
+            result.surplus = surplus;
+            equilibrium_price = point.price;
+        }
+        demand -= point.bid_quantity;
+    }
+    return result;
+}
+
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+AuctionResult BasicOrderBook<PricePolicy, LevelMap>::uncross(uint64_t timestamp) {
+    std::unique_lock<std::mutex> lock(mtx);
+    price_type equilibriumPrice{};
+    AuctionResult result = equilibrium_locked(equilibriumPrice);
+
+    // Execute the whole batch at the single equilibrium price, until one side
+    // has nothing left at or through it; that is exactly result.volume, but
+    // stopping on prices rather than on the summed volume is immune to
+    // rounding drift in the level totals. Auction trades have no aggressor:
+    // taker_order_id is the buy order, maker_order_id the sell.
+    if (result.volume <= 0)
+        return result;
+
+    // Every fill retires at least one order, so the orders resting at or
+    // through the price bound the fill count; reserving up front keeps the
+    // trade buffers from being regrown and copied mid-batch.
+    size_t crossedOrders = 0;
+    for (auto it = bids.begin(); it != bids.end() && !(it->first < equilibriumPrice); ++it)
+        crossedOrders += it->second.orders.size();
+    for (auto it = asks.begin(); it != asks.end() && !(equilibriumPrice < it->first); ++it)
+        crossedOrders += it->second.orders.size();
+    // The batch buffers are scratch members, borrowed for the call and handed
+    // back at the end: freeing buffers this size right after the batch has
+    // released its orders makes the allocator consolidate all of them.
+    trades.reserve(trades.size() + crossedOrders);
+    std::vector<Trade> batch;
+    std::vector<uint64_t> filled;
+    batch.swap(auction_trades);
+    filled.swap(auction_filled);
+    batch.clear();
+    batch.reserve(crossedOrders);
+    filled.clear();
+    filled.reserve(crossedOrders);
+
+    while (!bids.empty() && !asks.empty() &&
+           !(bids.begin()->first < equilibriumPrice) && !(equilibriumPrice < asks.begin()->first)) {
+        const RestingOrder& buy = bids.begin()->second.orders.front();
+        const RestingOrder& sell = asks.begin()->second.orders.front();
+        double volume = std::min(buy.quantity, sell.quantity);
+        Trade trade;
+        trade.timestamp = timestamp;
+        trade.price = result.price;
+        trade.quantity = volume;
+        trade.taker_order_id = buy.id;
+        trade.maker_order_id = sell.id;
+        trades.push_back(trade);
+        batch.push_back(trade);
+        consume_front<true>(volume, timestamp, &filled);
+        consume_front<false>(volume, timestamp, &filled);
+    }
+
+    // Retire filled ids in one pass. Sorted ids walk the index's buckets (and
+    // nodes, allocated in id order here) sequentially instead of at random.
+    std::sort(filled.begin(), filled.end());
+    for (uint64_t id : filled)
+        order_index.erase(id);
+
+    // Listeners may block (the engine's report ring) or do I/O, so the batch
+    // goes out once the book is consistent and unlocked.
+    auto onTrade = trade_listener;
+    auto onFilled = filled_listener;
+    lock.unlock();
+    if (onTrade) {
+        for (const Trade& trade : batch)
+            onTrade(trade);
+    }
+    if (onFilled) {
+        for (uint64_t id : filled)
+            onFilled(id);
+    }
+
+    lock.lock();
+    auction_trades.swap(batch);
+    auction_filled.swap(filled);
+    return result;
+}
+
+template class BasicOrderBook<DecimalPrice, MapLevels>;
+template class BasicOrderBook<TickPrice, MapLevels>;
+template class BasicOrderBook<TickPrice, FlatLevels>;
@@ -7,9 +7,19 @@
 #include <cmath>
 #include <algorithm>
 #include <chrono>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include "book_policies.h"
 
 enum class OrderType { LIMIT, MARKET };
 
+// What the engine should do with a queued Order. MODIFY and CANCEL only use
+// id (and price/quantity for MODIFY); the side comes from the resting order.
+// The AUCTION_* actions carry no order: they switch the trading phase
+// in-band so the switch stays sequenced with the order flow around it.
+enum class OrderAction { NEW, MODIFY, CANCEL, AUCTION_CALL, AUCTION_UNCROSS };
+
 struct Order {
     uint64_t id;
     double price;
@@ -18,29 +28,169 @@ struct Order {
     OrderType type;
     uint64_t timestamp;
     std::chrono::steady_clock::time_point submit_time;
+    OrderAction action = OrderAction::NEW;
+    uint32_t account = 0;  // Risk account; see RiskChecker
+};
+
+struct Trade {
+    uint64_t timestamp;  // Fix: Ensure timestamp exists
+    double price;
+    double quantity;
+    uint64_t taker_order_id;
+    uint64_t maker_order_id;
 };
 
-class OrderBook {
+// Equilibrium of a call auction: the price that maximizes executable volume.
+// surplus is bid demand minus ask supply at that price (> 0: buyers left over).
+// volume == 0 means the book does not cross.
+struct AuctionResult {
+    double price = 0.0;
+    double volume = 0.0;
+    double surplus = 0.0;
+};
+
+// New aggregate quantity at one price level; quantity 0 means the level is gone.
+struct BookDelta {
+    uint64_t timestamp;
+    bool is_bid;
+    double price;
+    double quantity;
+};
+
+// Order book parameterized on price representation and level container.
+// Bids and asks share one matching loop; the side and order type are fixed at
+// compile time, so the loop itself carries no is_bid/OrderType branches and
+// the crossing test is just the resting side's comparator.
+//
+// Each level keeps its resting orders in time priority, and an order-id index
+// points straight at a resting order so cancel and modify never scan a level.
+// With stable level iterators (MapLevels) the index also holds the level, so
+// cancel and modify are O(1); FlatLevels finds the level by price instead.
+template <typename PricePolicy, template <typename, typename, typename> class LevelMap>
+class BasicOrderBook {
 public:
-    struct Trade {
-        uint64_t timestamp;  // Fix: Ensure timestamp exists
-        double price;
+    using Trade = ::Trade;
+    using price_type = typename PricePolicy::type;
+
+    struct RestingOrder {
+        uint64_t id;
         double quantity;
-        uint64_t taker_order_id;
-        uint64_t maker_order_id;
+        uint64_t timestamp;
+    };
+
+    struct PriceLevel {
+        double quantity = 0.0;  // Sum of the resting orders' quantities
+        std::list<RestingOrder> orders;
     };
 
+    using BidLevels = LevelMap<price_type, PriceLevel, std::greater<price_type>>;
+    using AskLevels = LevelMap<price_type, PriceLevel, std::less<price_type>>;
+
     double match_order(const Order& order);
-    void add_order(const Order& order);
-    void cancel_order(uint64_t order_id);
+    // Rests the order. Returns false, leaving the book untouched, if an order
+    // with the same id is already resting.
+    bool add_order(const Order& order);
+    bool cancel_order(uint64_t order_id, uint64_t timestamp = 0);
 
-    const std::map<double, double, std::greater<double>>& get_bids() const;
-    const std::map<double, double>& get_asks() const;
+    // Amend a resting order. Reducing the quantity at the same price keeps
+    // time priority; a price change or size increase requeues the order at the
+    // back of its (new) level, matching first if the new price crosses.
+    // A quantity <= 0 cancels. Returns false if the order is not resting.
+    // With allow_match false (call phase) a requeued order rests even if it crosses.
+    bool modify_order(uint64_t order_id, double new_price, double new_quantity, uint64_t timestamp,
+                      bool allow_match = true);
+
+    // Call auction support. indicative_uncross() only computes the equilibrium;
+    // uncross() also executes every fill at that single price, bids against
+    // asks in price-time priority. Both run in O(price levels) plus the fills.
+    AuctionResult indicative_uncross();
+    AuctionResult uncross(uint64_t timestamp);
+
+    const BidLevels& get_bids() const;
+    const AskLevels& get_asks() const;
     std::vector<Trade> get_trades();
 
+    // Called for every trade in execution order, under the book lock, except
+    // for uncross(): its batch executes first and is delivered after the
+    // lock is released, followed by its filled orders.
+    void set_trade_listener(std::function<void(const Trade&)> listener);
+    // Called for every level change, under the book lock, in book order.
+    void set_delta_listener(std::function<void(const BookDelta&)> listener);
+    // Called when a resting order leaves the book fully filled, after the
+    // trade that filled it; under the book lock as for trades.
+    void set_filled_listener(std::function<void(uint64_t order_id)> listener);
+
 private:
-    std::map<double, double, std::greater<double>> bids;
-    std::map<double, double> asks;
+    struct NoLevel {};
+    template <typename Levels>
+    using LevelRef = std::conditional_t<stable_level_iterators<Levels>::value,
+                                        typename Levels::iterator, NoLevel>;
+
+    struct OrderRef {
+        bool is_bid;
+        price_type price;
+        typename std::list<RestingOrder>::iterator position;
+        LevelRef<BidLevels> bid_level;  // Set for bids only
+        LevelRef<AskLevels> ask_level;  // Set for asks only
+    };
+
+    double match_locked(const Order& order);
+    bool add_locked(const Order& order);
+    bool cancel_locked(uint64_t order_id, uint64_t timestamp);
+
+    template <bool IsBid, bool IsMarket>
+    double match_side(const Order& order, price_type limit);
+
+    template <bool IsBid>
+    auto& side_levels() {
+        if constexpr (IsBid) return bids; else return asks;
+    }
+
+    // The level a resting order sits on.
+    template <bool IsBid>
+    auto level_of(const OrderRef& ref) {
+        using Levels = std::remove_reference_t<decltype(side_levels<IsBid>())>;
+        if constexpr (!stable_level_iterators<Levels>::value)
+            return side_levels<IsBid>().find(ref.price);
+        else if constexpr (IsBid)
+            return ref.bid_level;
+        else
+            return ref.ask_level;
+    }
+
+    void record_trade(const Trade& trade);
+    void record_delta(uint64_t timestamp, bool is_bid, price_type price, double quantity);
+    void record_filled(uint64_t order_id);
+
+    struct AuctionPoint {
+        price_type price;
+        double bid_quantity;
+        double ask_quantity;
+    };
+    AuctionResult equilibrium_locked(price_type& equilibrium_price);
+    // With filled_ids set, ids of fully filled orders are collected there
+    // instead of being erased from order_index one by one.
+    template <bool IsBid>
+    void consume_front(double volume, uint64_t timestamp, std::vector<uint64_t>* filled_ids = nullptr);
+
+    BidLevels bids;
+    AskLevels asks;
+    std::unordered_map<uint64_t, OrderRef> order_index;
     std::vector<Trade> trades;
+    std::function<void(const Trade&)> trade_listener;
+    std::function<void(const BookDelta&)> delta_listener;
+    std::function<void(uint64_t)> filled_listener;
+    std::vector<AuctionPoint> auction_bids;    // Scratch for equilibrium_locked
+    std::vector<AuctionPoint> auction_points;
+    std::vector<Trade> auction_trades;         // Scratch for uncross
+    std::vector<uint64_t> auction_filled;
     mutable std::mutex mtx;
-};
\ No newline at end of file
+};
+
+// Instantiated in orderbook.cpp.
+extern template class BasicOrderBook<DecimalPrice, MapLevels>;
+extern template class BasicOrderBook<TickPrice, MapLevels>;
+extern template class BasicOrderBook<TickPrice, FlatLevels>;
+
+// Configuration used by the engine and GUI.
+using OrderBook = BasicOrderBook<DecimalPrice, MapLevels>;
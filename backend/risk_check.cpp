@@ -0,0 +1,163 @@
+#include "risk_check.h"
+#include <algorithm>
+#include <cmath>
+
+const char* to_string(RiskReject reason) {
+    switch (reason) {
+    case RiskReject::NONE:            return "accepted";
+    case RiskReject::INVALID_ORDER:   return "invalid price or quantity";
+    case RiskReject::UNKNOWN_ACCOUNT: return "unknown account";
+    case RiskReject::DUPLICATE_ID:    return "duplicate order id";
+    case RiskReject::FAT_FINGER:      return "fat-finger size";
+    case RiskReject::POSITION_LIMIT:  return "position limit";
+    case RiskReject::NOTIONAL_LIMIT:  return "notional limit";
+    case RiskReject::PRICE_BAND:      return "price band";
+    case RiskReject::SELF_TRADE:      return "self-trade";
+    }
+    return "unknown";
+}
+
+RiskChecker::RiskChecker()
+    : accounts(kMaxAccounts)
+{
+}
+
+void RiskChecker::reserve(size_t working_orders) {
+    working.reserve(working_orders);
+}
+
+void RiskChecker::set_limits(const RiskLimits& newLimits) {
+    limits = newLimits;
+}
+
+const RiskLimits& RiskChecker::get_limits() const {
+    return limits;
+}
+
+RiskReject RiskChecker::check(const Order& order) {
+    switch (order.action) {
+    case OrderAction::NEW: {
+        if (order.account >= kMaxAccounts)
+            return RiskReject::UNKNOWN_ACCOUNT;
+        // An id that is still working would alias the live order in the book.
+        if (working.find(order.id) != working.end())
+            return RiskReject::DUPLICATE_ID;
+        AccountState& account = accounts[order.account];
+        RiskReject reject = check_new(order, account);
+        if (reject != RiskReject::NONE)
+            return reject;
+        working[order.id] = WorkingOrder{order.account, order.is_bid, order.price, order.quantity};
+        add_working(account, order.is_bid, order.price, order.quantity);
+        return RiskReject::NONE;
+    }
+    case OrderAction::MODIFY: {
+        // Unknown to risk means it is not working; let the book turn it down.
+        auto found = working.find(order.id);
+        if (found == working.end())
+            return RiskReject::NONE;
+        WorkingOrder& resting = found->second;
+        AccountState& account = accounts[resting.account];
+
+        if (limits.max_order_quantity > 0 && order.quantity > limits.max_order_quantity)
+            return RiskReject::FAT_FINGER;
+        double sideWorking = resting.is_bid ? account.working_bid : account.working_ask;
+        double added = order.quantity - resting.open_quantity;
+        double projected = resting.is_bid ? account.position + sideWorking + added
+                                          : account.position - sideWorking - added;
+        if (limits.max_position > 0 && std::abs(projected) > limits.max_position)
+            return RiskReject::POSITION_LIMIT;
+        if (limits.max_notional > 0 && std::abs(projected) * order.price > limits.max_notional)
+            return RiskReject::NOTIONAL_LIMIT;
+        RiskReject reject = check_price(order, resting.is_bid, account);
+        if (reject != RiskReject::NONE)
+            return reject;
+
+        remove_working(account, resting.is_bid, resting.open_quantity);
+        add_working(account, resting.is_bid, order.price, order.quantity);
+        resting.price = order.price;
+        resting.open_quantity = order.quantity;
+        return RiskReject::NONE;
+    }
+    default:
+        return RiskReject::NONE;
+    }
+}
+
+RiskReject RiskChecker::check_new(const Order& order, AccountState& account) {
+    if (limits.max_order_quantity > 0 && order.quantity > limits.max_order_quantity)
+        return RiskReject::FAT_FINGER;
+
+    // Worst case: everything already working on this side fills too.
+    double projected = order.is_bid ? account.position + account.working_bid + order.quantity
+                                    : account.position - account.working_ask - order.quantity;
+    if (limits.max_position > 0 && std::abs(projected) > limits.max_position)
+        return RiskReject::POSITION_LIMIT;
+
+    double referencePrice = (order.type == OrderType::MARKET && last_trade_price > 0)
+                                ? last_trade_price : order.price;
+    if (limits.max_notional > 0 && std::abs(projected) * referencePrice > limits.max_notional)
+        return RiskReject::NOTIONAL_LIMIT;
+
+    return check_price(order, order.is_bid, account);
+}
+
+RiskReject RiskChecker::check_price(const Order& order, bool is_bid, const AccountState& account) const {
+    bool isMarket = order.action == OrderAction::NEW && order.type == OrderType::MARKET;
+
+    if (!isMarket && limits.price_band > 0 && last_trade_price > 0 &&
+        std::abs(order.price - last_trade_price) > limits.price_band * last_trade_price)
+        return RiskReject::PRICE_BAND;
+
+    // Conservative: the envelope only widens until that side is flat, so an
+    // order may be refused against a resting price that has since gone.
+    if (limits.self_trade_prevention) {
+        if (is_bid && account.working_ask > 0 && (isMarket || order.price >= account.best_ask))
+            return RiskReject::SELF_TRADE;
+        if (!is_bid && account.working_bid > 0 && (isMarket || order.price <= account.best_bid))
+            return RiskReject::SELF_TRADE;
+    }
+    return RiskReject::NONE;
+}
+
+void RiskChecker::on_report(const ExecutionReport& report) {
+    if (report.kind == ExecutionReport::Kind::FILL)
+        last_trade_price = report.price;
+
+    auto found = working.find(report.order_id);
+    if (found == working.end())
+        return;
+    WorkingOrder& order = found->second;
+    AccountState& account = accounts[order.account];
+
+    if (report.kind == ExecutionReport::Kind::FILL) {
+        account.position += order.is_bid ? report.quantity : -report.quantity;
+        double filled = std::min(report.quantity, order.open_quantity);
+        remove_working(account, order.is_bid, filled);
+        // Fills are summed in a different order than the book's, so the
+        // entry stays until the CLOSED report that follows the final fill.
+        order.open_quantity -= filled;
+    } else {
+        remove_working(account, order.is_bid, order.open_quantity);
+        working.erase(found);
+    }
+}
+
+void RiskChecker::add_working(AccountState& account, bool is_bid, double price, double quantity) {
+    if (is_bid) {
+        account.best_bid = account.working_bid > 0 ? std::max(account.best_bid, price) : price;
+        account.working_bid += quantity;
+    } else {
+        account.best_ask = account.working_ask > 0 ? std::min(account.best_ask, price) : price;
+        account.working_ask += quantity;
+    }
+}
+
+void RiskChecker::remove_working(AccountState& account, bool is_bid, double quantity) {
+    constexpr double kQuantityEpsilon = 1e-9;
+    double& open = is_bid ? account.working_bid : account.working_ask;
+    open -= quantity;
+    if (open <= kQuantityEpsilon) {
+        open = 0.0;
+        (is_bid ? account.best_bid : account.best_ask) = 0.0;
+    }
+}
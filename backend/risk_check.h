@@ -0,0 +1,78 @@
+#pragma once
+
+#include "orderbook.h"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Pre-trade limits. A zero/false value disables the corresponding check.
+struct RiskLimits {
+    double max_order_quantity = 10000.0;  // Fat-finger cap per order
+    double max_position = 0.0;            // |filled position + order| per account
+    double max_notional = 0.0;            // Projected |position| * price per account
+    double price_band = 0.0;              // Max fractional distance of a limit price from the last trade
+    bool self_trade_prevention = false;   // Reject orders that could cross the account's own resting orders
+};
+
+enum class RiskReject { NONE, INVALID_ORDER, UNKNOWN_ACCOUNT, DUPLICATE_ID, FAT_FINGER, POSITION_LIMIT, NOTIONAL_LIMIT, PRICE_BAND, SELF_TRADE };
+
+const char* to_string(RiskReject reason);
+
+// Sent back from the matching thread so risk state follows what actually
+// happened in the book. CLOSED is terminal: the order is no longer working
+// (fully filled, cancelled, refused by the book, or a modify found nothing
+// to amend), so whatever risk still counts as open for it is released.
+struct ExecutionReport {
+    enum class Kind : uint8_t { FILL, CLOSED };
+    Kind kind;
+    uint64_t order_id;
+    double price;
+    double quantity;
+};
+
+// Pre-trade risk state. Owned by a single thread (the engine's risk stage),
+// so nothing here is synchronized; per-account state is a flat,
+// cache-line-per-account array indexed by Order::account.
+class RiskChecker {
+public:
+    static constexpr uint32_t kMaxAccounts = 1024;
+
+    RiskChecker();
+
+    // Pre-sizes the working-order table for a live session.
+    void reserve(size_t working_orders);
+
+    void set_limits(const RiskLimits& limits);
+    const RiskLimits& get_limits() const;
+
+    // Checks an order on its way to matching and, if accepted, records it as
+    // working. CANCEL and control actions always pass.
+    RiskReject check(const Order& order);
+    void on_report(const ExecutionReport& report);
+
+private:
+    struct alignas(64) AccountState {
+        double position = 0.0;       // Net filled quantity (buys positive)
+        double working_bid = 0.0;    // Open quantity on each side
+        double working_ask = 0.0;
+        double best_bid = 0.0;       // Most aggressive working price per side;
+        double best_ask = 0.0;       // only reset once that side has no open quantity
+    };
+
+    struct WorkingOrder {
+        uint32_t account;
+        bool is_bid;
+        double price;
+        double open_quantity;
+    };
+
+    RiskReject check_new(const Order& order, AccountState& account);
+    RiskReject check_price(const Order& order, bool is_bid, const AccountState& account) const;
+    void add_working(AccountState& account, bool is_bid, double price, double quantity);
+    void remove_working(AccountState& account, bool is_bid, double quantity);
+
+    RiskLimits limits;
+    std::vector<AccountState> accounts;
+    std::unordered_map<uint64_t, WorkingOrder> working;
+    double last_trade_price = 0.0;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+// Bounded single-producer/single-consumer ring buffer.
+//
+// Head and tail live on separate cache lines, and each side keeps a private
+// copy of the other side's index so the shared counter is only re-read when
+// the ring looks full (producer) or empty (consumer).
+template <typename T>
+class SpscQueue {
+public:
+    // capacity is rounded up to a power of two. A zero-capacity queue holds
+    // nothing (every push fails) until allocate() is called.
+    explicit SpscQueue(size_t capacity = 0) {
+        if (capacity > 0)
+            allocate(capacity);
+    }
+
+    // (Re)sizes the ring and drops anything in it. Only while neither side
+    // is running.
+    void allocate(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        std::vector<T>(size).swap(slots);
+        mask = size - 1;
+        producer.index.store(0, std::memory_order_relaxed);
+        producer.cached_other = 0;
+        consumer.index.store(0, std::memory_order_relaxed);
+        consumer.cached_other = 0;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer side.
+    bool try_push(const T& value) {
+        size_t tail = producer.index.load(std::memory_order_relaxed);
+        if (tail - producer.cached_other == slots.size()) {
+            producer.cached_other = consumer.index.load(std::memory_order_acquire);
+            if (tail - producer.cached_other == slots.size())
+                return false;
+        }
+        slots[tail & mask] = value;
+        producer.index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side.
+    bool try_pop(T& value) {
+        size_t head = consumer.index.load(std::memory_order_relaxed);
+        if (head == consumer.cached_other) {
+            consumer.cached_other = producer.index.load(std::memory_order_acquire);
+            if (head == consumer.cached_other)
+                return false;
+        }
+        value = slots[head & mask];
+        consumer.index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when read from outside both sides (e.g. for metrics).
+    size_t size() const {
+        size_t head = consumer.index.load(std::memory_order_acquire);
+        size_t tail = producer.index.load(std::memory_order_acquire);
+        return tail >= head ? tail - head : 0;
+    }
+
+    // Safe from either side; exact only for the consumer.
+    bool empty() const {
+        return consumer.index.load(std::memory_order_acquire) ==
+               producer.index.load(std::memory_order_acquire);
+    }
+
+private:
+    struct alignas(64) Cursor {
+        std::atomic<size_t> index{0};
+        size_t cached_other = 0;  // Last seen index of the other side
+    };
+
+    Cursor producer;
+    Cursor consumer;
+    std::vector<T> slots;
+    size_t mask = 0;
+};
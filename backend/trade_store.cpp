@@ -0,0 +1,425 @@
+#include "trade_store.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Column kernels. Each keeps four independent lanes so the compiler can hold
+// them in one vector register (SSE2/AVX on x86, NEON on ARM) without having to
+// reassociate floating-point sums, which it may not do under strict FP rules.
+
+void sum_notional(const double* prices, const double* quantities, size_t n,
+                  double& notional, double& volume) {
+    double pv[4] = {0.0, 0.0, 0.0, 0.0};
+    double v[4] = {0.0, 0.0, 0.0, 0.0};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (size_t k = 0; k < 4; ++k) {
+            pv[k] += prices[i + k] * quantities[i + k];
+            v[k] += quantities[i + k];
+        }
+    }
+    for (; i < n; ++i) {
+        pv[0] += prices[i] * quantities[i];
+        v[0] += quantities[i];
+    }
+    notional += (pv[0] + pv[1]) + (pv[2] + pv[3]);
+    volume += (v[0] + v[1]) + (v[2] + v[3]);
+}
+
+void min_max(const double* prices, size_t n, double& low, double& high) {
+    double lo[4] = {low, low, low, low};
+    double hi[4] = {high, high, high, high};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (size_t k = 0; k < 4; ++k) {
+            lo[k] = prices[i + k] < lo[k] ? prices[i + k] : lo[k];
+            hi[k] = prices[i + k] > hi[k] ? prices[i + k] : hi[k];
+        }
+    }
+    for (; i < n; ++i) {
+        lo[0] = prices[i] < lo[0] ? prices[i] : lo[0];
+        hi[0] = prices[i] > hi[0] ? prices[i] : hi[0];
+    }
+    low = std::min(std::min(lo[0], lo[1]), std::min(lo[2], lo[3]));
+    high = std::max(std::max(hi[0], hi[1]), std::max(hi[2], hi[3]));
+}
+
+const char* const kColumnNames[5] = {"timestamp", "price", "quantity", "taker", "maker"};
+
+std::string column_path(const std::string& directory, uint64_t start_ms, int column) {
+    return directory + "/trades_" + std::to_string(start_ms) + "_" + kColumnNames[column] + ".col";
+}
+
+// Maps a whole column file read-only; bytes receives its size.
+void* map_column(const std::string& path, size_t& bytes) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open trade column " << path << std::endl;
+        return nullptr;
+    }
+    struct stat info{};
+    void* data = MAP_FAILED;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+        bytes = static_cast<size_t>(info.st_size);
+        data = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "Failed to map trade column " << path << std::endl;
+        return nullptr;
+    }
+    return data;
+}
+
+} // namespace
+
+TradeStore::MappedColumn::~MappedColumn() {
+    if (data)
+        munmap(data, bytes);
+}
+
+void TradeStore::Partition::bind_vectors() {
+    timestamps = timestamp_column.data();
+    prices = price_column.data();
+    quantities = quantity_column.data();
+    taker_ids = taker_column.data();
+    maker_ids = maker_column.data();
+}
+
+void TradeStore::Partition::bind_mapped() {
+    timestamps = static_cast<const uint64_t*>(mapped[0].data);
+    prices = static_cast<const double*>(mapped[1].data);
+    quantities = static_cast<const double*>(mapped[2].data);
+    taker_ids = static_cast<const uint64_t*>(mapped[3].data);
+    maker_ids = static_cast<const uint64_t*>(mapped[4].data);
+}
+
+TradeStore::TradeStore(uint64_t partition_ms)
+    : partition_ms(partition_ms == 0 ? 1 : partition_ms)
+{
+}
+
+// Sealed partitions still queued are written before the writer exits, and
+// the active partition is spilled too, so a run directory holds every trade.
+TradeStore::~TradeStore() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        spill_stopping = true;
+    }
+    spill_cv.notify_all();
+    if (spill_thread.joinable())
+        spill_thread.join();
+
+    if (!spill_directory.empty() && !partitions.empty() && !partitions.back()->mapped[0].data) {
+        MappedColumn mapped[5];
+        write_columns(*partitions.back(), spill_directory, mapped);
+    }
+}
+
+bool TradeStore::set_spill_directory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mtx);
+    spill_directory.clear();
+    if (directory.empty())
+        return true;
+
+    // Wall-clock time plus pid: unique across runs, reboots and concurrent
+    // processes sharing the same base directory.
+    auto wallMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::string runDirectory = directory + "/run_" + std::to_string(wallMs) + "_" + std::to_string(::getpid());
+    ::mkdir(directory.c_str(), 0755);
+    if (::mkdir(runDirectory.c_str(), 0755) != 0) {
+        std::cerr << "Failed to create trade run directory " << runDirectory << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    spill_directory = runDirectory;
+    if (!spill_thread.joinable())
+        spill_thread = std::thread(&TradeStore::spill_thread_main, this);
+    return true;
+}
+
+std::string TradeStore::get_spill_directory() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return spill_directory;
+}
+
+bool TradeStore::open_spilled(const std::string& run_directory) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!partitions.empty()) {
+        std::cerr << "Trade store must be empty to open " << run_directory << std::endl;
+        return false;
+    }
+
+    // Partitions are found by their timestamp column: trades_<start>_timestamp.col
+    DIR* dir = ::opendir(run_directory.c_str());
+    if (!dir) {
+        std::cerr << "Failed to open trade run directory " << run_directory << std::endl;
+        return false;
+    }
+    std::vector<uint64_t> starts;
+    const std::string prefix = "trades_";
+    const std::string suffix = "_timestamp.col";
+    while (dirent* entry = ::readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+            continue;
+        std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+        if (std::all_of(digits.begin(), digits.end(), [](unsigned char c) { return std::isdigit(c); }))
+            starts.push_back(std::stoull(digits));
+    }
+    ::closedir(dir);
+    std::sort(starts.begin(), starts.end());
+
+    std::vector<std::unique_ptr<Partition>> loaded;
+    uint64_t count = 0;
+    for (uint64_t start : starts) {
+        auto partition = std::make_unique<Partition>();
+        partition->start_ms = start;
+        for (int i = 0; i < 5; ++i) {
+            size_t bytes = 0;
+            void* data = map_column(column_path(run_directory, start, i), bytes);
+            if (!data)
+                return false;
+            partition->mapped[i].data = data;
+            partition->mapped[i].bytes = bytes;
+        }
+        // Every column holds one 8-byte value per trade.
+        partition->count = partition->mapped[0].bytes / sizeof(uint64_t);
+        for (const MappedColumn& column : partition->mapped) {
+            if (column.bytes != partition->count * sizeof(uint64_t)) {
+                std::cerr << "Trade columns disagree in length for partition " << start
+                          << " in " << run_directory << std::endl;
+                return false;
+            }
+        }
+        partition->bind_mapped();
+        count += partition->count;
+        loaded.push_back(std::move(partition));
+    }
+
+    partitions = std::move(loaded);
+    total_count = count;
+    last_ts = partitions.empty() ? 0 : partitions.back()->max_ts();
+    return true;
+}
+
+void TradeStore::append(const Trade& trade) {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    // Keep the time column sorted; a trade stamped slightly behind the
+    // previous one (submit-time skew between producers, or the wall clock
+    // stepping back) is recorded at it.
+    uint64_t ts = std::max(trade.timestamp, last_ts);
+    uint64_t start = ts / partition_ms * partition_ms;
+
+    if (partitions.empty() || partitions.back()->start_ms != start) {
+        if (!partitions.empty())
+            seal(*partitions.back());
+        partitions.push_back(std::make_unique<Partition>());
+        partitions.back()->start_ms = start;
+    }
+
+    Partition& active = *partitions.back();
+    active.timestamp_column.push_back(ts);
+    active.price_column.push_back(trade.price);
+    active.quantity_column.push_back(trade.quantity);
+    active.taker_column.push_back(trade.taker_order_id);
+    active.maker_column.push_back(trade.maker_order_id);
+    active.count = active.timestamp_column.size();
+    active.bind_vectors();
+
+    last_ts = ts;
+    ++total_count;
+}
+
+// Spilled columns are dropped once mapped, so only partitions kept in memory
+// are worth the copy that shrinking them costs.
+void TradeStore::seal(Partition& partition) {
+    if (!spill_directory.empty()) {
+        spill_queue.push_back(SpillJob{&partition, spill_directory});
+        spill_cv.notify_one();
+        return;
+    }
+    partition.timestamp_column.shrink_to_fit();
+    partition.price_column.shrink_to_fit();
+    partition.quantity_column.shrink_to_fit();
+    partition.taker_column.shrink_to_fit();
+    partition.maker_column.shrink_to_fit();
+    partition.bind_vectors();
+}
+
+// A sealed partition is never written again, so its vectors can be read
+// without the lock; only the swap to the mapping needs it, since queries
+// may be reading the vectors until then.
+void TradeStore::spill_thread_main() {
+    while (true) {
+        SpillJob job;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            spill_cv.wait(lock, [this]{ return spill_stopping || !spill_queue.empty(); });
+            if (spill_queue.empty())
+                return;
+            job = spill_queue.front();
+            spill_queue.pop_front();
+        }
+
+        MappedColumn mapped[5];
+        if (!write_columns(*job.partition, job.directory, mapped))
+            continue;
+        // The replaced vectors are freed once the lock is released.
+        Partition retired;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            adopt_mapped(*job.partition, mapped, retired);
+        }
+    }
+}
+
+bool TradeStore::write_columns(const Partition& partition, const std::string& directory, MappedColumn (&mapped)[5]) {
+    const void* columns[5] = {partition.timestamps, partition.prices, partition.quantities,
+                              partition.taker_ids, partition.maker_ids};
+    const size_t bytes = partition.count * sizeof(uint64_t);  // All columns are 8 bytes wide
+
+    for (int i = 0; i < 5; ++i) {
+        std::string path = column_path(directory, partition.start_ms, i);
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(static_cast<const char*>(columns[i]), static_cast<std::streamsize>(bytes));
+            if (!out) {
+                std::cerr << "Failed to write trade column " << path << std::endl;
+                return false;
+            }
+        }
+        mapped[i].data = map_column(path, mapped[i].bytes);
+        if (!mapped[i].data)
+            return false;
+    }
+    return true;
+}
+
+void TradeStore::adopt_mapped(Partition& partition, MappedColumn (&mapped)[5], Partition& retired) {
+    for (int i = 0; i < 5; ++i) {
+        std::swap(partition.mapped[i].data, mapped[i].data);
+        std::swap(partition.mapped[i].bytes, mapped[i].bytes);
+    }
+    partition.bind_mapped();
+
+    retired.timestamp_column.swap(partition.timestamp_column);
+    retired.price_column.swap(partition.price_column);
+    retired.quantity_column.swap(partition.quantity_column);
+    retired.taker_column.swap(partition.taker_column);
+    retired.maker_column.swap(partition.maker_column);
+}
+
+void TradeStore::range(const Partition& partition, uint64_t from_ms, uint64_t to_ms,
+                       size_t& begin, size_t& end) {
+    const uint64_t* first = partition.timestamps;
+    const uint64_t* last = partition.timestamps + partition.count;
+    begin = static_cast<size_t>(std::lower_bound(first, last, from_ms) - first);
+    end = static_cast<size_t>(std::lower_bound(first + begin, last, to_ms) - first);
+}
+
+TradeStats TradeStore::stats(uint64_t from_ms, uint64_t to_ms) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    TradeStats result;
+    double notional = 0.0;
+    double low = std::numeric_limits<double>::infinity();
+    double high = -std::numeric_limits<double>::infinity();
+
+    for (const auto& partition : partitions) {
+        if (partition->count == 0 || partition->max_ts() < from_ms || partition->min_ts() >= to_ms)
+            continue;
+        size_t begin, end;
+        range(*partition, from_ms, to_ms, begin, end);
+        if (begin == end)
+            continue;
+        sum_notional(partition->prices + begin, partition->quantities + begin, end - begin,
+                     notional, result.volume);
+        min_max(partition->prices + begin, end - begin, low, high);
+        result.count += end - begin;
+    }
+
+    if (result.count > 0) {
+        result.vwap = result.volume > 0 ? notional / result.volume : 0.0;
+        result.low = low;
+        result.high = high;
+    }
+    return result;
+}
+
+std::vector<TradeBar> TradeStore::bars(uint64_t from_ms, uint64_t to_ms, uint64_t interval_ms) const {
+    std::vector<TradeBar> result;
+    if (interval_ms == 0 || to_ms <= from_ms)
+        return result;
+    size_t bucketCount = static_cast<size_t>((to_ms - from_ms + interval_ms - 1) / interval_ms);
+    result.resize(bucketCount);
+    std::vector<double> notionals(bucketCount, 0.0);
+    for (size_t b = 0; b < bucketCount; ++b)
+        result[b].start_ms = from_ms + b * interval_ms;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    for (const auto& partition : partitions) {
+        if (partition->count == 0 || partition->max_ts() < from_ms || partition->min_ts() >= to_ms)
+            continue;
+        size_t begin, end;
+        range(*partition, from_ms, to_ms, begin, end);
+
+        // Timestamps are sorted, so each bucket is one contiguous slice.
+        const uint64_t* ts = partition->timestamps;
+        while (begin < end) {
+            size_t b = static_cast<size_t>((ts[begin] - from_ms) / interval_ms);
+            uint64_t bucketEnd = std::min(to_ms, from_ms + (b + 1) * interval_ms);
+            size_t sliceEnd = static_cast<size_t>(std::lower_bound(ts + begin, ts + end, bucketEnd) - ts);
+
+            TradeBar& bar = result[b];
+            const double* prices = partition->prices + begin;
+            size_t n = sliceEnd - begin;
+            if (bar.count == 0) {
+                bar.open = prices[0];
+                bar.low = prices[0];
+                bar.high = prices[0];
+            }
+            sum_notional(prices, partition->quantities + begin, n, notionals[b], bar.volume);
+            min_max(prices, n, bar.low, bar.high);
+            bar.close = prices[n - 1];
+            bar.count += n;
+            begin = sliceEnd;
+        }
+    }
+
+    for (size_t b = 0; b < bucketCount; ++b) {
+        if (result[b].volume > 0)
+            result[b].vwap = notionals[b] / result[b].volume;
+    }
+    return result;
+}
+
+std::vector<double> TradeStore::volume_by_interval(uint64_t from_ms, uint64_t to_ms, uint64_t interval_ms) const {
+    std::vector<double> result;
+    for (const TradeBar& bar : bars(from_ms, to_ms, interval_ms))
+        result.push_back(bar.volume);
+    return result;
+}
+
+uint64_t TradeStore::size() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return total_count;
+}
+
+uint64_t TradeStore::last_timestamp() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return last_ts;
+}
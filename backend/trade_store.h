@@ -0,0 +1,136 @@
+#pragma once
+
+#include "orderbook.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <cstdint>
+
+// Aggregates over a time range [from_ms, to_ms).
+struct TradeStats {
+    uint64_t count = 0;
+    double volume = 0.0;
+    double vwap = 0.0;
+    double high = 0.0;
+    double low = 0.0;
+};
+
+// One fixed-width interval, e.g. a candlestick. count == 0 for empty buckets.
+struct TradeBar {
+    uint64_t start_ms = 0;
+    double open = 0.0;
+    double high = 0.0;
+    double low = 0.0;
+    double close = 0.0;
+    double volume = 0.0;
+    double vwap = 0.0;
+    uint64_t count = 0;
+};
+
+// Append-only columnar trade history.
+//
+// Trades are stored struct-of-arrays in time partitions of partition_ms. The
+// active partition lives in vectors; when time moves past it the partition is
+// sealed and, if a spill directory is set, queued for a background writer
+// that stores it as one file per column and swaps in a read-only mapping of
+// them, so append() never waits on disk; until then queries read the sealed
+// vectors. Timestamps are kept non-decreasing, so every partition doubles as
+// its own index: partitions outside a query range are skipped on their
+// min/max and the rest are narrowed by binary search before the aggregate
+// kernels run over contiguous column slices.
+class TradeStore {
+public:
+    explicit TradeStore(uint64_t partition_ms = 60000);
+    ~TradeStore();
+
+    TradeStore(const TradeStore&) = delete;
+    TradeStore& operator=(const TradeStore&) = delete;
+
+    // Sealed partitions go to a new run directory inside `directory`
+    // (run_<wall-clock ms>_<pid>), so no run ever truncates another's files,
+    // including ones still mapped elsewhere. The active partition is written
+    // too when the store is destroyed, and the files outlive the process for
+    // offline analysis; see open_spilled(). Empty (the default) keeps
+    // sealed partitions in memory. Returns false if the run directory could
+    // not be created.
+    bool set_spill_directory(const std::string& directory);
+    std::string get_spill_directory() const;  // The run directory, if any
+
+    // Maps every partition previously spilled to run_directory, read-only,
+    // so the usual queries run over a past session. Only on an empty store.
+    bool open_spilled(const std::string& run_directory);
+
+    void append(const Trade& trade);
+
+    TradeStats stats(uint64_t from_ms, uint64_t to_ms) const;
+    std::vector<double> volume_by_interval(uint64_t from_ms, uint64_t to_ms, uint64_t interval_ms) const;
+    std::vector<TradeBar> bars(uint64_t from_ms, uint64_t to_ms, uint64_t interval_ms) const;
+
+    uint64_t size() const;
+    uint64_t last_timestamp() const;
+
+private:
+    struct MappedColumn {
+        void* data = nullptr;
+        size_t bytes = 0;
+        ~MappedColumn();
+    };
+
+    struct Partition {
+        uint64_t start_ms = 0;
+        size_t count = 0;
+
+        // Column pointers, into either the vectors below or the mappings.
+        const uint64_t* timestamps = nullptr;
+        const double* prices = nullptr;
+        const double* quantities = nullptr;
+        const uint64_t* taker_ids = nullptr;
+        const uint64_t* maker_ids = nullptr;
+
+        std::vector<uint64_t> timestamp_column;
+        std::vector<double> price_column;
+        std::vector<double> quantity_column;
+        std::vector<uint64_t> taker_column;
+        std::vector<uint64_t> maker_column;
+
+        MappedColumn mapped[5];
+
+        void bind_vectors();
+        void bind_mapped();
+        uint64_t min_ts() const { return timestamps[0]; }
+        uint64_t max_ts() const { return timestamps[count - 1]; }
+    };
+
+    struct SpillJob {
+        Partition* partition = nullptr;
+        std::string directory;
+    };
+
+    void seal(Partition& partition);
+    // Writes and maps the partition's columns; adopt_mapped() swaps them in
+    // and moves the vectors they replace to retired.
+    static bool write_columns(const Partition& partition, const std::string& directory, MappedColumn (&mapped)[5]);
+    static void adopt_mapped(Partition& partition, MappedColumn (&mapped)[5], Partition& retired);
+    void spill_thread_main();
+
+    // Slice of one partition whose timestamps fall in [from_ms, to_ms).
+    static void range(const Partition& partition, uint64_t from_ms, uint64_t to_ms,
+                      size_t& begin, size_t& end);
+
+    uint64_t partition_ms;
+    std::string spill_directory;
+    std::vector<std::unique_ptr<Partition>> partitions;  // Ordered by start_ms; back() is active
+    uint64_t total_count = 0;
+    uint64_t last_ts = 0;
+    mutable std::mutex mtx;
+
+    // Background spill writer, started with the first spill directory.
+    std::thread spill_thread;
+    std::condition_variable spill_cv;
+    std::deque<SpillJob> spill_queue;
+    bool spill_stopping = false;
+};
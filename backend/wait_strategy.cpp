@@ -0,0 +1,58 @@
+#include "wait_strategy.h"
+#include <iostream>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+
+const char* to_string(WaitStrategy strategy) {
+    switch (strategy) {
+    case WaitStrategy::BLOCKING:       return "blocking";
+    case WaitStrategy::YIELD:          return "yield";
+    case WaitStrategy::BUSY_SPIN:      return "busy-spin";
+    case WaitStrategy::SPIN_THEN_PARK: return "spin-then-park";
+    }
+    return "unknown";
+}
+
+bool parse_wait_strategy(const std::string& name, WaitStrategy& strategy) {
+    for (WaitStrategy candidate : {WaitStrategy::BLOCKING, WaitStrategy::YIELD,
+                                   WaitStrategy::BUSY_SPIN, WaitStrategy::SPIN_THEN_PARK}) {
+        if (name == to_string(candidate)) {
+            strategy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool apply_thread_config(const EngineThreadConfig& config) {
+    bool ok = true;
+
+    if (config.cpu >= 0) {
+#ifdef __linux__
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(config.cpu, &cpus);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (rc != 0) {
+            std::cerr << "Failed to pin thread to CPU " << config.cpu << ": " << std::strerror(rc) << std::endl;
+            ok = false;
+        }
+#else
+        std::cerr << "CPU pinning is not supported on this platform" << std::endl;
+        ok = false;
+#endif
+    }
+
+    if (config.realtime) {
+        sched_param param{};
+        param.sched_priority = config.realtime_priority;
+        int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (rc != 0) {
+            std::cerr << "Failed to enable SCHED_FIFO: " << std::strerror(rc) << std::endl;
+            ok = false;
+        }
+    }
+
+    return ok;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstdint>
+#include <string>
+
+// How a consumer thread waits for work.
+enum class WaitStrategy {
+    BLOCKING,        // Park on a condition variable (lowest CPU, futex wakeup)
+    YIELD,           // Poll, yielding the CPU between polls
+    BUSY_SPIN,       // Poll continuously (burns a core, lowest latency)
+    SPIN_THEN_PARK   // Spin for spin_budget polls, then park
+};
+
+const char* to_string(WaitStrategy strategy);
+// Accepts the names produced by to_string(). Returns false on an unknown name.
+bool parse_wait_strategy(const std::string& name, WaitStrategy& strategy);
+
+struct EngineThreadConfig {
+    WaitStrategy wait_strategy = WaitStrategy::BLOCKING;
+    uint32_t spin_budget = 20000;  // Polls before parking (SPIN_THEN_PARK only)
+    int cpu = -1;                  // Pin the thread to this CPU when >= 0 (Linux only)
+    int risk_cpu = -1;             // Same, for the engine's risk-check stage
+    bool realtime = false;         // Run under SCHED_FIFO
+    int realtime_priority = 50;
+};
+
+// Applies CPU affinity and scheduling policy to the calling thread.
+// Returns false (and logs) if any requested setting could not be applied.
+bool apply_thread_config(const EngineThreadConfig& config);
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Wakes one consumer waiting on a lock-free "work available" predicate.
+// Producers publish work first, then call notify(); the condition variable is
+// only touched when the consumer has actually parked, so spinning consumers
+// never cost the producer a syscall.
+class WaitSignal {
+public:
+    template <typename Ready>
+    void wait(WaitStrategy strategy, uint32_t spin_budget, Ready ready) {
+        switch (strategy) {
+        case WaitStrategy::BUSY_SPIN:
+            while (!ready())
+                cpu_relax();
+            return;
+        case WaitStrategy::YIELD:
+            while (!ready())
+                std::this_thread::yield();
+            return;
+        case WaitStrategy::SPIN_THEN_PARK:
+            for (uint32_t i = 0; i < spin_budget; ++i) {
+                if (ready())
+                    return;
+                cpu_relax();
+            }
+            park(ready);
+            return;
+        case WaitStrategy::BLOCKING:
+            park(ready);
+            return;
+        }
+    }
+
+    void notify() {
+        // Pairs with the fence in park(): publishing work is often just a
+        // release store (SPSC ring), which alone may still sit in the store
+        // buffer when parked is read, so both sides could miss each other.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked.load()) {
+            std::lock_guard<std::mutex> lock(mtx);
+            cv.notify_one();
+        }
+    }
+
+    // Unconditional wakeup, e.g. on shutdown.
+    void notify_all() {
+        std::lock_guard<std::mutex> lock(mtx);
+        cv.notify_all();
+    }
+
+private:
+    template <typename Ready>
+    void park(Ready& ready) {
+        std::unique_lock<std::mutex> lock(mtx);
+        parked.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv.wait(lock, ready);
+        parked.store(false);
+    }
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::atomic<bool> parked{false};
+};
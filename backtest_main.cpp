@@ -0,0 +1,154 @@
+#include "backtest.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void usage() {
+    std::cerr <<
+        "Usage:\n"
+        "  orderbook_backtest <events.bin> [--threads N] [--windows K]\n"
+        "                     [--spreads a,b,...] [--sizes a,b,...] [--requote N]\n"
+        "  orderbook_backtest --generate <events.bin> <count> [--seed S]\n";
+}
+
+std::vector<double> parse_list(const std::string& text) {
+    std::vector<double> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+        values.push_back(std::stod(item));
+    return values;
+}
+
+// Synthetic flow in the spirit of the GUI simulation: limit orders scattered
+// around a random-walk mid, some market orders, and cancels of earlier orders.
+std::vector<RecordedEvent> generate_events(size_t count, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<RecordedEvent> events;
+    events.reserve(count);
+    double mid = 100.0;
+    uint64_t timestamp = 0;
+    for (size_t i = 0; i < count; ++i) {
+        mid = std::max(1.0, mid + (unit(rng) - 0.5) * 0.1);
+        timestamp += 1 + static_cast<uint64_t>(unit(rng) * 5);
+
+        Order order{};
+        order.id = i + 1;
+        order.timestamp = timestamp;
+        order.account = static_cast<uint32_t>(rng() % 100);
+        order.is_bid = unit(rng) < 0.5;
+        double roll = unit(rng);
+        if (roll < 0.1 && i > 0) {
+            order.action = OrderAction::CANCEL;
+            order.id = 1 + rng() % i;
+        } else {
+            order.type = roll < 0.25 ? OrderType::MARKET : OrderType::LIMIT;
+            double offset = unit(rng) * 1.0;
+            order.price = order.is_bid ? mid - offset : mid + offset;
+            order.quantity = 1.0 + std::floor(unit(rng) * 20.0);
+        }
+        events.push_back(RecordedEvent::from_order(order));
+    }
+    return events;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    std::string first = argv[1];
+    if (first == "--generate") {
+        if (argc < 4) {
+            usage();
+            return 1;
+        }
+        uint64_t seed = 1;
+        for (int i = 4; i + 1 < argc; i += 2) {
+            if (std::string(argv[i]) == "--seed") seed = std::strtoull(argv[i + 1], nullptr, 10);
+        }
+        size_t count = std::strtoull(argv[3], nullptr, 10);
+        return write_event_file(argv[2], generate_events(count, seed)) ? 0 : 1;
+    }
+
+    unsigned threads = 0;
+    size_t windows = 4;
+    std::vector<double> spreads = {0.02, 0.05, 0.1, 0.2};
+    std::vector<double> sizes = {1.0, 5.0, 10.0};
+    uint32_t requote = 50;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        if (flag == "--threads") threads = static_cast<unsigned>(std::stoul(value));
+        else if (flag == "--windows") windows = std::max<size_t>(1, std::stoul(value));
+        else if (flag == "--spreads") spreads = parse_list(value);
+        else if (flag == "--sizes") sizes = parse_list(value);
+        else if (flag == "--requote") requote = static_cast<uint32_t>(std::stoul(value));
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    EventFile events;
+    if (!events.open(first))
+        return 1;
+
+    // Scenarios: the whole file, then K equal windows of it.
+    std::vector<Scenario> scenarios = {{"all", 0, 0}};
+    for (size_t w = 0; w < windows && windows > 1; ++w) {
+        scenarios.push_back({"window" + std::to_string(w),
+                             events.size() * w / windows, events.size() * (w + 1) / windows});
+    }
+
+    std::vector<StrategyParams> grid;
+    for (double spread : spreads) {
+        for (double size : sizes) {
+            StrategyParams params;
+            params.half_spread = spread;
+            params.quote_size = size;
+            params.requote_interval = requote;
+            grid.push_back(params);
+        }
+    }
+
+    BacktestRunner runner(threads);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BacktestResult> results = runner.run(events, scenarios, grid);
+    double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("scenario,half_spread,quote_size,events,quotes,rejects,fills,bought,sold,inventory,pnl,wall_ms\n");
+    const BacktestResult* best = nullptr;
+    double runMs = 0.0;
+    for (const BacktestResult& r : results) {
+        const StrategyParams& p = grid[r.params_index];
+        std::printf("%s,%.4f,%.2f,%llu,%llu,%llu,%llu,%.2f,%.2f,%.2f,%.4f,%.2f\n",
+                    scenarios[r.scenario_index].name.c_str(), p.half_spread, p.quote_size,
+                    static_cast<unsigned long long>(r.events), static_cast<unsigned long long>(r.quotes),
+                    static_cast<unsigned long long>(r.risk_rejects), static_cast<unsigned long long>(r.fills),
+                    r.bought, r.sold, r.inventory, r.pnl, r.wall_ms);
+        runMs += r.wall_ms;
+        if (r.scenario_index == 0 && (!best || r.pnl > best->pnl))
+            best = &r;
+    }
+
+    std::fprintf(stderr, "%zu runs over %zu events on %u threads: %.1f ms wall, %.1f ms summed run time\n",
+                 results.size(), events.size(), runner.thread_count(), totalMs, runMs);
+    if (best) {
+        std::fprintf(stderr, "Best on full file: half_spread %.4f, quote_size %.2f, pnl %.4f\n",
+                     grid[best->params_index].half_spread, grid[best->params_index].quote_size, best->pnl);
+    }
+    return 0;
+}
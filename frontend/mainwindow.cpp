@@ -1,5 +1,7 @@
 #include "mainwindow.h"
 #include "matching_engine.h"
+#include "trade_store.h"
+#include "metrics_server.h"
 
 #include <QtCharts/QChart>
 #include <QtCharts/QValueAxis>
@@ -26,8 +28,69 @@
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
       engine(new MatchingEngine),
-      update_timer(new QTimer(this))
+      update_timer(new QTimer(this)),
+      frame_timer(new QTimer(this))
 {
+    // Engine thread tuning, chosen per deployment:
+    //   ORDERBOOK_WAIT_STRATEGY = blocking | yield | busy-spin | spin-then-park
+    //   ORDERBOOK_SPIN_BUDGET, ORDERBOOK_ENGINE_CPU, ORDERBOOK_ENGINE_FIFO=1
+    EngineThreadConfig threadConfig;
+    QString waitName = qEnvironmentVariable("ORDERBOOK_WAIT_STRATEGY");
+    if (!waitName.isEmpty() && !parse_wait_strategy(waitName.toStdString(), threadConfig.wait_strategy)) {
+        qDebug() << "Unknown wait strategy" << waitName << "- using blocking";
+    }
+    bool ok = false;
+    int spinBudget = qEnvironmentVariableIntValue("ORDERBOOK_SPIN_BUDGET", &ok);
+    if (ok && spinBudget > 0) threadConfig.spin_budget = static_cast<uint32_t>(spinBudget);
+    int cpu = qEnvironmentVariableIntValue("ORDERBOOK_ENGINE_CPU", &ok);
+    if (ok) threadConfig.cpu = cpu;
+    threadConfig.realtime = qEnvironmentVariableIntValue("ORDERBOOK_ENGINE_FIFO") != 0;
+    engine->set_thread_config(threadConfig);
+
+    // Optional directory for memory-mapped trade history partitions
+    QString tradeDir = qEnvironmentVariable("ORDERBOOK_TRADE_DIR");
+    if (!tradeDir.isEmpty()) {
+        TradeStore& store = engine->get_trade_store();
+        if (store.set_spill_directory(tradeDir.toStdString())) {
+            qDebug() << "Spilling trade partitions to" << QString::fromStdString(store.get_spill_directory());
+        }
+    }
+
+    // Refresh limits: ORDERBOOK_MAX_FPS, ORDERBOOK_FRAME_BUDGET_MS
+    int envFps = qEnvironmentVariableIntValue("ORDERBOOK_MAX_FPS", &ok);
+    if (ok && envFps > 0) maxFps = envFps;
+    int envBudget = qEnvironmentVariableIntValue("ORDERBOOK_FRAME_BUDGET_MS", &ok);
+    if (ok && envBudget > 0) frameBudgetMs = envBudget;
+
+    // Runs on the matching thread: flag the change and post at most one
+    // frame request until the GUI has consumed it.
+    engine->set_delta_listener([this](const BookDelta& delta) {
+        std::lock_guard<std::mutex> lock(deltaMutex);
+        pendingDeltas.push_back(delta);
+    });
+    engine->set_update_listener([this] {
+        if (!dataChanged.exchange(true)) {
+            QMetaObject::invokeMethod(this, [this] { requestFrame(); }, Qt::QueuedConnection);
+        }
+    });
+
+    // GUI render metrics share the engine's registry
+    fpsGauge = &engine->get_metrics().gauge("orderbook_gui_fps", "GUI frames rendered per second");
+    frameTimeHistogram = &engine->get_metrics().histogram("orderbook_gui_frame_seconds", "GUI frame render time",
+                                                          {0.001, 0.002, 0.004, 0.008, 0.016, 0.033, 0.1});
+
+    // Prometheus scrape endpoint on 127.0.0.1:ORDERBOOK_METRICS_PORT
+    int metricsPort = qEnvironmentVariableIntValue("ORDERBOOK_METRICS_PORT", &ok);
+    if (ok && metricsPort > 0 && metricsPort < 65536) {
+        metrics_server = new MetricsServer(engine->get_metrics());
+        if (!metrics_server->start(static_cast<uint16_t>(metricsPort))) {
+            delete metrics_server;
+            metrics_server = nullptr;
+        } else {
+            qDebug() << "Serving metrics on http://127.0.0.1:" << metrics_server->get_port() << "/metrics";
+        }
+    }
+
     engine->start();
 
     // Setup the main UI layout (splitters)
@@ -38,9 +101,14 @@ MainWindow::MainWindow(QWidget *parent)
     setupChart();
     setupAdvancedChart();
 
-    // Periodic GUI updates
-    connect(update_timer, &QTimer::timeout, this, &MainWindow::update_gui);
+    // Frames are driven by data changes; the periodic timer only keeps the
+    // metrics moving while the engine is idle.
+    frame_timer->setSingleShot(true);
+    connect(frame_timer, &QTimer::timeout, this, &MainWindow::update_gui);
+    connect(update_timer, &QTimer::timeout, this, &MainWindow::requestFrame);
     update_timer->start(1000);
+    fpsClock.start();
+    requestFrame();
 
     // Timer for simulated limit orders
     QTimer* simulationTimer = new QTimer(this);
@@ -57,6 +125,7 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    delete metrics_server;
     engine->stop();
     delete engine;
 }
@@ -88,6 +157,9 @@ void MainWindow::setupUI()
     metricsLayout->addWidget(latencyBar);
     metricsLayout->addWidget(throughputLabel);
     metricsLayout->addWidget(throughputBar);
+
+    renderLabel = new QLabel("Render: -");
+    metricsLayout->addWidget(renderLabel);
     metricsBox->setLayout(metricsLayout);
 
     // (B) Order Submission Form
@@ -116,6 +188,21 @@ void MainWindow::setupUI()
     formLayout->addRow("", submitButton);
     orderFormGroup->setLayout(formLayout);
 
+    // (B2) Call Auction controls
+    QGroupBox* auctionBox = new QGroupBox("Call Auction");
+    QVBoxLayout* auctionLayout = new QVBoxLayout(auctionBox);
+    auctionLabel = new QLabel("Phase: Continuous");
+    auctionCallButton = new QPushButton("Start Call Phase");
+    uncrossButton = new QPushButton("Uncross");
+    uncrossButton->setEnabled(false);
+    connect(auctionCallButton, &QPushButton::clicked, this, &MainWindow::startCallAuction);
+    connect(uncrossButton, &QPushButton::clicked, this, &MainWindow::uncrossAuction);
+    QHBoxLayout* auctionButtons = new QHBoxLayout;
+    auctionButtons->addWidget(auctionCallButton);
+    auctionButtons->addWidget(uncrossButton);
+    auctionLayout->addWidget(auctionLabel);
+    auctionLayout->addLayout(auctionButtons);
+
     // (C) Trade History Table
     tradeTable = new QTableWidget;
     tradeTable->setColumnCount(5);
@@ -130,6 +217,7 @@ void MainWindow::setupUI()
     // Put them all into the left panel layout
     leftPanelLayout->addWidget(metricsBox);
     leftPanelLayout->addWidget(orderFormGroup);
+    leftPanelLayout->addWidget(auctionBox);
     leftPanelLayout->addWidget(tradeTable);
     leftPanelLayout->addStretch(1);
     leftPanelWidget->setLayout(leftPanelLayout);
@@ -167,6 +255,9 @@ void MainWindow::setupChart()
 
     bids_series->setName("Bids");
     asks_series->setName("Asks");
+    // Depth series can hold every price level; draw them with OpenGL
+    bids_series->setUseOpenGL(true);
+    asks_series->setUseOpenGL(true);
     chart->addSeries(bids_series);
     chart->addSeries(asks_series);
 
@@ -200,7 +291,7 @@ void MainWindow::setupChart()
     }
 }
 
-// 3) Advanced Candlestick Chart
+// 3) Advanced Candlestick Chart (filled from the engine's trade store)
 void MainWindow::setupAdvancedChart()
 {
     QChart* advChart = new QChart;
@@ -208,22 +299,6 @@ void MainWindow::setupAdvancedChart()
     // Candlestick
     candlestick_series = new QCandlestickSeries;
     candlestick_series->setName("Candlestick");
-
-    const int numCandles = 10;
-    QVector<QCandlestickSet*> candleSets;
-    for (int i = 0; i < numCandles; i++) {
-        double open = 50.0 + QRandomGenerator::global()->generateDouble() * 50.0;
-        double close = 50.0 + QRandomGenerator::global()->generateDouble() * 50.0;
-        double high = std::max(open, close) + QRandomGenerator::global()->generateDouble() * 5.0;
-        double low = std::min(open, close) - QRandomGenerator::global()->generateDouble() * 5.0;
-        low = std::min(low, std::min(open, close));
-        high = std::max(high, std::max(open, close));
-        QCandlestickSet* set = new QCandlestickSet(open, high, low, close);
-        candleSets.append(set);
-    }
-    for (auto set : candleSets) {
-        candlestick_series->append(set);
-    }
     advChart->addSeries(candlestick_series);
 
     // Axes
@@ -235,28 +310,14 @@ void MainWindow::setupAdvancedChart()
 
     QValueAxis* axisXAdv = new QValueAxis;
     axisXAdv->setTitleText("Time (Candle Index)");
-    axisXAdv->setRange(0, numCandles - 1);
+    axisXAdv->setRange(0, kCandleCount - 1);
     advChart->addAxis(axisXAdv, Qt::AlignBottom);
     candlestick_series->attachAxis(axisXAdv);
 
     // Moving Average
     moving_average_series = new QLineSeries;
     moving_average_series->setName("Moving Average");
-    const int windowSize = 3;
-    QVector<double> closes;
-    closes.reserve(numCandles);
-    for (int i = 0; i < numCandles; i++) {
-        closes.append(candleSets[i]->close());
-    }
-
-    for (int i = windowSize - 1; i < numCandles; i++) {
-        double sum = 0;
-        for (int j = i - windowSize + 1; j <= i; j++) {
-            sum += closes[j];
-        }
-        double avg = sum / windowSize;
-        moving_average_series->append(i - (windowSize / 2.0), avg);
-    }
+    moving_average_series->setUseOpenGL(true);
     advChart->addSeries(moving_average_series);
     moving_average_series->attachAxis(axisXAdv);
     moving_average_series->attachAxis(axisYAdv);
@@ -275,54 +336,172 @@ void MainWindow::setupAdvancedChart()
     }
 }
 
-// 4) Periodic GUI Updates
+// Rebuild the candles for the most recent kCandleCount intervals of trades.
+void MainWindow::updateCandles()
+{
+    TradeStore& store = engine->get_trade_store();
+    if (store.size() == 0) return;
+
+    uint64_t to = (store.last_timestamp() / kCandleIntervalMs + 1) * kCandleIntervalMs;
+    uint64_t from = to > kCandleCount * kCandleIntervalMs ? to - kCandleCount * kCandleIntervalMs : 0;
+    std::vector<TradeBar> bars = store.bars(from, to, kCandleIntervalMs);
+
+    candlestick_series->clear();
+    moving_average_series->clear();
+
+    double low = 0, high = 0;
+    bool first = true;
+    QVector<QPointF> closes;
+    for (size_t i = 0; i < bars.size(); i++) {
+        const TradeBar& bar = bars[i];
+        if (bar.count == 0) continue;
+        candlestick_series->append(new QCandlestickSet(bar.open, bar.high, bar.low, bar.close, static_cast<qreal>(i)));
+        closes.append(QPointF(static_cast<qreal>(i), bar.close));
+        low = first ? bar.low : std::min(low, bar.low);
+        high = first ? bar.high : std::max(high, bar.high);
+        first = false;
+    }
+
+    const int windowSize = 3;
+    for (int i = windowSize - 1; i < closes.size(); i++) {
+        double sum = 0;
+        for (int j = i - windowSize + 1; j <= i; j++) {
+            sum += closes[j].y();
+        }
+        moving_average_series->append(closes[i].x(), sum / windowSize);
+    }
+
+    auto verticalAxes = advanced_chart_view->chart()->axes(Qt::Vertical);
+    if (!first && !verticalAxes.isEmpty()) {
+        double pad = std::max(1.0, (high - low) * 0.1);
+        verticalAxes.first()->setRange(low - pad, high + pad);
+    }
+}
+
+// 4) GUI Updates
+
+// Schedule a frame no sooner than 1/maxFps after the previous one.
+void MainWindow::requestFrame()
+{
+    if (frame_timer->isActive()) return;
+
+    qint64 minInterval = 1000 / maxFps;
+    qint64 wait = 0;
+    if (sinceLastFrame.isValid()) {
+        wait = std::max<qint64>(0, minInterval - sinceLastFrame.elapsed());
+    }
+    frame_timer->start(static_cast<int>(wait));
+}
+
+// One frame. Stages run in priority order and stop once the frame budget is
+// spent; whatever is left stays dirty and a follow-up frame is requested.
 void MainWindow::update_gui()
 {
-    // (A) Update order book
-    bids_series->clear();
-    asks_series->clear();
+    QElapsedTimer frame;
+    frame.start();
+    sinceLastFrame.restart();
+    auto overBudget = [&] { return frame.elapsed() >= frameBudgetMs; };
 
     auto& orderBook = engine->get_order_book();
-    const auto& bids = orderBook.get_bids();
-    const auto& asks = orderBook.get_asks();
+    if (dataChanged.exchange(false)) {
+        depthDirty = true;
+        candlesDirty = true;
+        auto newTrades = orderBook.get_trades();
+        pendingTrades.insert(pendingTrades.end(), newTrades.begin(), newTrades.end());
+    }
 
-    for (const auto& bid : bids) {
-        bids_series->append(bid.first, bid.second);
+    // (A) Update order book
+    if (depthDirty) {
+        updateDepth();
+        depthDirty = false;
+    }
+
+    // (B) Update trade history table, in chunks
+    const size_t chunk = 64;
+    if (pendingTradeOffset < pendingTrades.size()) {
+        tradeTable->setUpdatesEnabled(false);
+        while (pendingTradeOffset < pendingTrades.size() && !overBudget()) {
+            size_t end = std::min(pendingTrades.size(), pendingTradeOffset + chunk);
+            for (; pendingTradeOffset < end; pendingTradeOffset++) {
+                const Trade& trade = pendingTrades[pendingTradeOffset];
+                int row = tradeTable->rowCount();
+                tradeTable->insertRow(row);
+                tradeTable->setItem(row, 0, new QTableWidgetItem(QString::number(trade.timestamp)));
+                tradeTable->setItem(row, 1, new QTableWidgetItem(QString::number(trade.price, 'f', 2)));
+                tradeTable->setItem(row, 2, new QTableWidgetItem(QString::number(trade.quantity, 'f', 2)));
+                tradeTable->setItem(row, 3, new QTableWidgetItem(QString::number(trade.taker_order_id)));
+                tradeTable->setItem(row, 4, new QTableWidgetItem(QString::number(trade.maker_order_id)));
+            }
+        }
+        tradeTable->setUpdatesEnabled(true);
+        if (pendingTradeOffset == pendingTrades.size()) {
+            pendingTrades.clear();
+            pendingTradeOffset = 0;
+        }
+    }
+
+    // (B2) Candles from the trade store
+    if (candlesDirty && !overBudget()) {
+        updateCandles();
+        candlesDirty = false;
+    }
+
+    // (C) Metrics are cheap but still yield to the budget
+    if (!overBudget()) {
+        updateMetrics();
+    }
+
+    bool deferred = candlesDirty || !pendingTrades.empty() || overBudget();
+    updateRenderStats(frame.nsecsElapsed() / 1e6, deferred);
+    if (deferred) {
+        requestFrame();
+    }
+}
+
+void MainWindow::updateDepth()
+{
+    std::vector<BookDelta> deltas;
+    {
+        std::lock_guard<std::mutex> lock(deltaMutex);
+        deltas.swap(pendingDeltas);
     }
-    for (const auto& ask : asks) {
-        asks_series->append(ask.first, ask.second);
+    for (const BookDelta& delta : deltas) {
+        auto& depth = delta.is_bid ? bidDepth : askDepth;
+        if (delta.quantity > 0) {
+            depth[delta.price] = delta.quantity;
+        } else {
+            depth.erase(delta.price);
+        }
     }
 
+    // Build the point lists once and hand them over in a single replace()
+    QList<QPointF> bidPoints;
+    QList<QPointF> askPoints;
+    double maxQty = 0;
+    for (const auto& bid : bidDepth) {
+        bidPoints.append(QPointF(bid.first, bid.second));
+        maxQty = std::max(maxQty, bid.second);
+    }
+    for (const auto& ask : askDepth) {
+        askPoints.append(QPointF(ask.first, ask.second));
+        maxQty = std::max(maxQty, ask.second);
+    }
+    bids_series->replace(bidPoints);
+    asks_series->replace(askPoints);
+
     // Update Y-axis range
     QChart* chart = depth_chart_view->chart();
     if (chart) {
-        double maxQty = 0;
-        for (const auto& b : bids) {
-            maxQty = std::max(maxQty, b.second);
-        }
-        for (const auto& a : asks) {
-            maxQty = std::max(maxQty, a.second);
-        }
         if (maxQty < 60) maxQty = 60;
         auto verticalAxes = chart->axes(Qt::Vertical);
         if (!verticalAxes.isEmpty()) {
             verticalAxes.first()->setRange(0, maxQty * 1.1);
         }
     }
+}
 
-    // (B) Update trade history table
-    auto newTrades = orderBook.get_trades();
-    for (const auto& trade : newTrades) {
-        int row = tradeTable->rowCount();
-        tradeTable->insertRow(row);
-        tradeTable->setItem(row, 0, new QTableWidgetItem(QString::number(trade.timestamp)));
-        tradeTable->setItem(row, 1, new QTableWidgetItem(QString::number(trade.price, 'f', 2)));
-        tradeTable->setItem(row, 2, new QTableWidgetItem(QString::number(trade.quantity, 'f', 2)));
-        tradeTable->setItem(row, 3, new QTableWidgetItem(QString::number(trade.taker_order_id)));
-        tradeTable->setItem(row, 4, new QTableWidgetItem(QString::number(trade.maker_order_id)));
-    }
-
-    // (C) Update metrics
+void MainWindow::updateMetrics()
+{
     double avgLatency = engine->getAverageLatencyMs();
     double throughput = engine->getThroughputOps();
 
@@ -332,12 +511,61 @@ void MainWindow::update_gui()
     latencyBar->setValue(latencyVal);
     throughputBar->setValue(throughputVal);
 
-    latencyLabel->setText(QString("Latency: %1 ms").arg(avgLatency, 0, 'f', 2));
-    throughputLabel->setText(QString("Throughput: %1 ops").arg(throughput, 0, 'f', 1));
+    latencyLabel->setText(QString("Latency: %1 ms").arg(avgLatency, 0, 'f', 3));
+    throughputLabel->setText(QString("Throughput: %1 orders/s, %2 trades/s")
+                                 .arg(throughput, 0, 'f', 1)
+                                 .arg(engine->getTradeRate(), 0, 'f', 1));
+
+    // (C2) Auction phase and indicative uncross
+    if (engine->getTradingPhase() == TradingPhase::CALL_AUCTION) {
+        auctionLabel->setText(QString("Phase: Call | Indicative: %1 x %2 | Market orders refused: %3")
+                                  .arg(engine->getIndicativePrice(), 0, 'f', 2)
+                                  .arg(engine->getIndicativeVolume(), 0, 'f', 2)
+                                  .arg(engine->getAuctionRejectedCount()));
+    } else if (engine->getLastUncrossVolume() > 0) {
+        auctionLabel->setText(QString("Phase: Continuous | Last uncross: %1 x %2")
+                                  .arg(engine->getLastUncrossPrice(), 0, 'f', 2)
+                                  .arg(engine->getLastUncrossVolume(), 0, 'f', 2));
+    } else {
+        auctionLabel->setText("Phase: Continuous");
+    }
 
     // (D) Status bar for total processed orders
     uint64_t processed = engine->getProcessedOrderCount();
-    statusBar()->showMessage(QString("Processed Orders: %1").arg(processed));
+    uint64_t rejected = engine->getRejectedOrderCount();
+    QString riskText = QString("Risk: %1 ns/check, %2 rejected").arg(engine->getAverageRiskCheckNs(), 0, 'f', 0).arg(rejected);
+    if (rejected > 0) {
+        riskText += QString(" (last: %1)").arg(to_string(engine->getLastRejectReason()));
+    }
+    statusBar()->showMessage(QString("Processed Orders: %1 | Wakeup (%2): avg %3 us, max %4 us | %5")
+                                 .arg(processed)
+                                 .arg(to_string(engine->get_thread_config().wait_strategy))
+                                 .arg(engine->getAverageWakeupLatencyUs(), 0, 'f', 1)
+                                 .arg(engine->getMaxWakeupLatencyNs() / 1000.0, 0, 'f', 1)
+                                 .arg(riskText));
+}
+
+void MainWindow::updateRenderStats(double frameMs, bool deferred)
+{
+    lastFrameMs = frameMs;
+    avgFrameMs = avgFrameMs == 0 ? frameMs : avgFrameMs * 0.9 + frameMs * 0.1;
+    if (deferred) deferredFrames++;
+    frameTimeHistogram->observe(frameMs / 1e3);
+
+    framesThisSecond++;
+    if (fpsClock.elapsed() >= 1000) {
+        fps = framesThisSecond * 1000.0 / fpsClock.elapsed();
+        framesThisSecond = 0;
+        fpsClock.restart();
+        fpsGauge->set(fps);
+    }
+
+    renderLabel->setText(QString("Render: %1 fps | frame %2 ms (avg %3, budget %4) | deferred %5")
+                             .arg(fps, 0, 'f', 1)
+                             .arg(lastFrameMs, 0, 'f', 2)
+                             .arg(avgFrameMs, 0, 'f', 2)
+                             .arg(frameBudgetMs)
+                             .arg(deferredFrames));
 }
 
 // 5) Submitting an Order
@@ -357,7 +585,6 @@ void MainWindow::submitOrder()
     QString orderTypeStr = orderTypeCombo->currentText();
 
     Order order;
-    static uint64_t nextOrderId = 1;
     order.id = nextOrderId++;
     order.price = price;
     order.quantity = quantity;
@@ -387,7 +614,6 @@ void MainWindow::simulateOrder()
     bool isBuy = (QRandomGenerator::global()->bounded(0, 2) == 0);
 
     Order order;
-    static uint64_t nextOrderId = 10000;
     order.id = nextOrderId++;
     order.price = price;
     order.quantity = quantity;
@@ -406,7 +632,6 @@ void MainWindow::simulateLiveMarketData()
     bool isBuy = (QRandomGenerator::global()->bounded(0, 2) == 0);
 
     Order order;
-    static uint64_t nextOrderId = 20000;
     order.id = nextOrderId++;
     order.price = price;
     order.quantity = quantity;
@@ -415,4 +640,21 @@ void MainWindow::simulateLiveMarketData()
     order.timestamp = static_cast<uint64_t>(QDateTime::currentMSecsSinceEpoch());
 
     engine->submit_order(order);
+}
+
+// 8) Call auction phase control
+void MainWindow::startCallAuction()
+{
+    engine->begin_call_auction();
+    auctionCallButton->setEnabled(false);
+    uncrossButton->setEnabled(true);
+    statusBar()->showMessage("Call phase started: orders rest without matching.");
+}
+
+void MainWindow::uncrossAuction()
+{
+    engine->uncross_auction();
+    auctionCallButton->setEnabled(true);
+    uncrossButton->setEnabled(false);
+    statusBar()->showMessage("Auction uncross requested.");
 }
\ No newline at end of file
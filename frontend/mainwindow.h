@@ -16,8 +16,17 @@
 #include <QTableWidget>
 #include <QProgressBar>
 #include <QLabel>
+#include <QElapsedTimer>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "orderbook.h"
 
 class MatchingEngine;
+class MetricsServer;
+class Gauge;
+class Histogram;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -27,17 +36,60 @@ public:
 
 private slots:
     void update_gui();
+    void requestFrame();
     void submitOrder();
     void simulateOrder();
     void simulateLiveMarketData();
+    void startCallAuction();
+    void uncrossAuction();
 
 private:
     void setupUI();
     void setupChart();
     void setupAdvancedChart();
+    void updateDepth();
+    void updateCandles();
+    void updateMetrics();
+    void updateRenderStats(double frameMs, bool deferred);
+
+    static constexpr int kCandleCount = 20;
+    static constexpr uint64_t kCandleIntervalMs = 5000;
 
     MatchingEngine* engine;
+    uint64_t nextOrderId = 1;  // Shared by manual and simulated orders so ids never collide
     QTimer* update_timer;
+    MetricsServer* metrics_server = nullptr;  // Only when ORDERBOOK_METRICS_PORT is set
+
+    // Adaptive refresh: frames are requested by engine updates (coalesced)
+    // and by update_timer, rate-limited to maxFps, and each frame stops
+    // starting new work once frameBudgetMs is spent; the rest is deferred.
+    QTimer* frame_timer;
+    QElapsedTimer sinceLastFrame;
+    std::atomic<bool> dataChanged{true};
+    int maxFps = 30;
+    int frameBudgetMs = 8;
+    bool depthDirty = true;
+    bool candlesDirty = true;
+    std::vector<Trade> pendingTrades;
+    size_t pendingTradeOffset = 0;
+
+    // Depth chart state, rebuilt from the engine's level deltas rather than
+    // by reading the live book from the GUI thread.
+    std::mutex deltaMutex;
+    std::vector<BookDelta> pendingDeltas;  // Guarded by deltaMutex
+    std::map<double, double> bidDepth;
+    std::map<double, double> askDepth;
+
+    // Render timing
+    QLabel* renderLabel;
+    QElapsedTimer fpsClock;
+    int framesThisSecond = 0;
+    double fps = 0;
+    double lastFrameMs = 0;
+    double avgFrameMs = 0;
+    uint64_t deferredFrames = 0;
+    Gauge* fpsGauge;             // Exported through the engine's registry
+    Histogram* frameTimeHistogram;
 
     // Metrics Dashboard widgets
     QProgressBar* latencyBar;
@@ -53,6 +105,11 @@ private:
     QPushButton* submitButton;
     QGroupBox* orderFormGroup;
 
+    // Call auction controls
+    QPushButton* auctionCallButton;
+    QPushButton* uncrossButton;
+    QLabel* auctionLabel;
+
     // We'll create two main splitters:
     // 1) mainHorizontalSplitter (left vs right)
     // 2) On the right side, a vertical splitter for the two charts